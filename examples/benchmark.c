@@ -0,0 +1,827 @@
+#include "../include/raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Headless benchmark: renders fixed cases with warmup frames and repeated
+// timed frames, then reports wall-clock statistics per case. Every timed
+// frame traces the same samples, so runs are comparable across commits.
+// With --scaling it instead sweeps procedural scene size, light count and
+// resolution for one case and charts the time per frame. --counters adds
+// hardware counters (IPC, cache and branch misses per ray) where Linux
+// perf_event_open is available.
+
+typedef enum
+{
+    BENCH_RASTERIZATION,
+    BENCH_BASIC,
+    BENCH_ADVANCED,
+    BENCH_ANTI_ALIASED,
+    BENCH_ADAPTIVE,
+    BENCH_WAVEFRONT,
+    BENCH_WAVEFRONT_SORTED,
+    BENCH_CASE_COUNT
+} BenchmarkCase;
+
+static const char *case_names[BENCH_CASE_COUNT] = {
+    "rasterization", "basic", "advanced", "aa4", "adaptive", "wavefront", "wavefront-sorted"};
+
+typedef struct
+{
+    const char *name;
+    int frames;
+    double median;
+    double p95;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    double samples_per_frame; // camera samples, averaged over the timed frames
+    double rays_per_frame;    // all rays with RAYTRACING_STATS, else camera samples
+    PerfReading counters;     // totals over the timed frames; nothing valid without --counters
+} BenchmarkStats;
+
+// One point of a scaling sweep
+typedef struct
+{
+    int spheres;
+    int lights;
+    int width;
+    int height;
+    double build; // scene generation plus BVH build, in seconds
+    BenchmarkStats stats;
+} ScalingPoint;
+
+#define MAX_SWEEP_VALUES 16
+
+// What the per-ray counter figures are divided by
+#ifdef RAYTRACING_STATS
+#define RAY_BASIS "ray (all ray types; camera samples for the basic case)"
+#else
+#define RAY_BASIS "camera sample (build with RAYTRACING_STATS to count every ray)"
+#endif
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options] [scene_file]\n", program);
+    printf("  -w, --width N             Frame width in pixels (default %d)\n", WINDOW_WIDTH);
+    printf("  -h, --height N            Frame height in pixels (default %d)\n", WINDOW_HEIGHT);
+    printf("  -t, --threads N           Render threads (default: one per CPU)\n");
+    printf("      --warmup N            Untimed frames before each case (default 2)\n");
+    printf("      --repeat N            Timed frames per case (default 10)\n");
+    printf("      --case NAME           Run only this case; may be repeated\n");
+    printf("      --json FILE           Write results as JSON\n");
+    printf("      --csv FILE            Write results as CSV\n");
+    printf("      --counters            Collect hardware counters per case (Linux perf_event_open)\n");
+    printf("      --generate KIND       Render a procedural scene instead of a scene file\n");
+    printf("      --spheres N           Spheres in the procedural scene (default 1000)\n");
+    printf("      --lights N            Lights in the procedural scene (default: per kind, at most %d)\n", MAX_LIGHTS);
+    printf("      --seed N              Procedural scene seed (default 1)\n");
+    printf("      --scaling             Sweep sizes, light counts and resolutions for one case (default advanced)\n");
+    printf("      --sizes LIST          Sphere counts to sweep (default 10,100,1000,10000,100000)\n");
+    printf("      --light-counts LIST   Light counts to sweep (default 2)\n");
+    printf("      --resolutions LIST    Resolutions to sweep as WxH (default 320x240)\n");
+    printf("Cases:");
+    for (int i = 0; i < BENCH_CASE_COUNT; i++)
+        printf(" %s", case_names[i]);
+    printf("\nScene kinds:");
+    for (int i = 0; i < SCENE_KIND_COUNT; i++)
+        printf(" %s", scene_kind_name((SceneKind)i));
+    printf("\nWithout a scene file the four-sphere scene of performance_comparison is used.\n");
+}
+
+static Scene *create_default_scene(void)
+{
+    Scene *scene = scene_create();
+    if (!scene)
+        return NULL;
+
+    Material red_material = {color_create(0.8f, 0.2f, 0.2f), 0.1f, 0.8f, 0.9f, 64.0f};
+    Material blue_material = {color_create(0.2f, 0.2f, 0.8f), 0.1f, 0.7f, 0.8f, 128.0f};
+    Material green_material = {color_create(0.2f, 0.8f, 0.2f), 0.1f, 0.6f, 0.3f, 16.0f};
+    Material metallic_material = {color_create(0.9f, 0.9f, 0.9f), 0.05f, 0.3f, 0.95f, 256.0f};
+
+    scene_add_sphere(scene, vector3_create(0.0f, 0.0f, -5.0f), 1.0f, red_material);
+    scene_add_sphere(scene, vector3_create(-2.5f, 0.0f, -4.0f), 0.8f, blue_material);
+    scene_add_sphere(scene, vector3_create(2.5f, -1.0f, -6.0f), 1.2f, green_material);
+    scene_add_sphere(scene, vector3_create(0.0f, -2.0f, -4.5f), 0.6f, metallic_material);
+
+    scene_add_light(scene, vector3_create(3.0f, 3.0f, 2.0f), color_create(1.0f, 1.0f, 1.0f), 1.0f);
+    scene_add_light(scene, vector3_create(-2.0f, 1.0f, 1.0f), color_create(0.3f, 0.3f, 0.8f), 0.5f);
+    return scene;
+}
+
+static RenderSettings case_settings(BenchmarkCase bench_case)
+{
+    RenderSettings settings = {
+        .enable_shadows = true,
+        .enable_reflections = true,
+        .enable_anti_aliasing = false,
+        .samples_per_pixel = 1,
+        .reflection_strength = 0.3f};
+
+    if (bench_case == BENCH_ANTI_ALIASED || bench_case == BENCH_ADAPTIVE || bench_case == BENCH_WAVEFRONT ||
+        bench_case == BENCH_WAVEFRONT_SORTED)
+    {
+        settings.enable_anti_aliasing = true;
+        settings.samples_per_pixel = 4;
+    }
+    if (bench_case == BENCH_ADAPTIVE)
+    {
+        settings.enable_adaptive_aa = true;
+        settings.adaptive_min_samples = 2;
+        settings.adaptive_threshold = 0.05f;
+    }
+    if (bench_case == BENCH_WAVEFRONT || bench_case == BENCH_WAVEFRONT_SORTED)
+        settings.enable_wavefront = true;
+    if (bench_case == BENCH_WAVEFRONT_SORTED)
+        settings.enable_ray_sorting = true; // compare with wavefront for the gain from sorting bounce rays
+    return settings;
+}
+
+// Render one frame of a case and return the camera samples it traced
+static unsigned long long run_frame(BenchmarkCase bench_case, RenderContext *context, Framebuffer *framebuffer,
+                                    Scene *scene, Camera *camera)
+{
+    if (bench_case == BENCH_RASTERIZATION)
+    {
+        Vector3 light_pos = vector3_create(400, 200, 100);
+        framebuffer_clear(framebuffer, 20, 20, 40);
+        draw_sphere_simple(framebuffer, 200, 150, 80, light_pos);
+        draw_sphere_simple(framebuffer, 400, 200, 60, light_pos);
+        draw_sphere_simple(framebuffer, 600, 250, 100, light_pos);
+        draw_sphere_simple(framebuffer, 300, 350, 70, light_pos);
+        return 0;
+    }
+    if (bench_case == BENCH_BASIC)
+    {
+        render_scene(framebuffer, scene, camera->position);
+        return (unsigned long long)framebuffer->width * framebuffer->height;
+    }
+
+    RenderSettings settings = case_settings(bench_case);
+    context->frame_index = 0; // identical jitter every frame
+    render_scene_advanced(context, framebuffer, scene, camera, &settings);
+    return context->samples_traced;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Summarize frame times (sorted in place)
+static void compute_stats(double *times, int count, BenchmarkStats *stats)
+{
+    qsort(times, (size_t)count, sizeof(double), compare_doubles);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++)
+        sum += times[i];
+    stats->mean = sum / count;
+
+    double squares = 0.0;
+    for (int i = 0; i < count; i++)
+        squares += (times[i] - stats->mean) * (times[i] - stats->mean);
+    stats->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+
+    stats->frames = count;
+    stats->min = times[0];
+    stats->max = times[count - 1];
+    stats->median = count % 2 ? times[count / 2] : 0.5 * (times[count / 2 - 1] + times[count / 2]);
+
+    // Nearest-rank 95th percentile
+    int rank = (int)ceil(0.95 * count);
+    stats->p95 = times[rank > 0 ? rank - 1 : 0];
+}
+
+// A counter per traced ray over the timed frames; false when unavailable
+static bool counter_per_ray(const BenchmarkStats *stats, PerfCounterKind kind, double *value)
+{
+    double rays = stats->rays_per_frame * stats->frames;
+    if (!stats->counters.valid[kind] || rays <= 0.0)
+        return false;
+    *value = stats->counters.values[kind] / rays;
+    return true;
+}
+
+// Instructions per cycle; false when either counter is unavailable
+static bool counter_ipc(const BenchmarkStats *stats, double *value)
+{
+    const PerfReading *c = &stats->counters;
+    if (!c->valid[PERF_CYCLES] || !c->valid[PERF_INSTRUCTIONS] || c->values[PERF_CYCLES] <= 0.0)
+        return false;
+    *value = c->values[PERF_INSTRUCTIONS] / c->values[PERF_CYCLES];
+    return true;
+}
+
+static bool any_counter(const BenchmarkStats *stats)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (stats->counters.valid[i])
+            return true;
+    }
+    return false;
+}
+
+// Derived counter columns, in table, JSON and CSV order
+#define DERIVED_COUNTER_COUNT 5
+static const char *derived_names[DERIVED_COUNTER_COUNT] = {
+    "ipc", "cycles_per_ray", "l1d_misses_per_ray", "llc_misses_per_ray", "branch_misses_per_ray"};
+
+static bool derived_counter(const BenchmarkStats *stats, int index, double *value)
+{
+    static const PerfCounterKind per_ray[DERIVED_COUNTER_COUNT - 1] = {PERF_CYCLES, PERF_L1D_MISSES, PERF_LLC_MISSES,
+                                                                       PERF_BRANCH_MISSES};
+    if (index == 0)
+        return counter_ipc(stats, value);
+    return counter_per_ray(stats, per_ray[index - 1], value);
+}
+
+static void print_counter_table(const BenchmarkStats *results, int count)
+{
+    printf("\nHardware counters over the timed frames, per %s:\n", RAY_BASIS);
+    printf("%-16s | %8s | %10s | %12s | %12s | %12s\n", "Case", "IPC", "Cycles", "L1D misses", "LLC misses",
+           "Br. misses");
+    printf("-----------------|----------|------------|--------------|--------------|-------------\n");
+    for (int i = 0; i < count; i++)
+    {
+        printf("%-16s", results[i].name);
+        for (int d = 0; d < DERIVED_COUNTER_COUNT; d++)
+        {
+            static const int widths[DERIVED_COUNTER_COUNT] = {8, 10, 12, 12, 12};
+            static const int decimals[DERIVED_COUNTER_COUNT] = {2, 0, 3, 3, 3};
+            double value;
+            if (derived_counter(&results[i], d, &value))
+                printf(" | %*.*f", widths[d], decimals[d], value);
+            else
+                printf(" | %*s", widths[d], "n/a");
+        }
+        printf("\n");
+    }
+}
+
+static int write_json(const char *path, const BenchmarkStats *results, int count, int width, int height,
+                      int threads, int warmup, const char *scene_name)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s for writing\n", path);
+        return -1;
+    }
+
+    double pixels = (double)width * height;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scene\": \"%s\",\n", scene_name);
+    fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"threads\": %d,\n", width, height, threads);
+    fprintf(file, "  \"warmup\": %d,\n  \"math_backend\": \"%s\",\n", warmup, VECTOR_MATH_BACKEND);
+    fprintf(file, "  \"cases\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const BenchmarkStats *s = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"frames\": %d, \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+                      "\"mean_ms\": %.4f, \"stddev_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, "
+                      "\"samples_per_frame\": %.0f, \"samples_per_second\": %.0f, \"pixels_per_second\": %.0f, "
+                      "\"rays_per_frame\": %.0f",
+                s->name, s->frames, s->median * 1e3, s->p95 * 1e3, s->mean * 1e3, s->stddev * 1e3,
+                s->min * 1e3, s->max * 1e3, s->samples_per_frame, s->samples_per_frame / s->median,
+                pixels / s->median, s->rays_per_frame);
+
+        // Raw totals and derived figures; null where a counter is unavailable
+        if (any_counter(s))
+        {
+            fprintf(file, ", \"counters\": {");
+            for (int k = 0; k < PERF_COUNTER_COUNT; k++)
+            {
+                if (s->counters.valid[k])
+                    fprintf(file, "\"%s\": %.0f, ", perf_counter_name((PerfCounterKind)k), s->counters.values[k]);
+                else
+                    fprintf(file, "\"%s\": null, ", perf_counter_name((PerfCounterKind)k));
+            }
+            for (int d = 0; d < DERIVED_COUNTER_COUNT; d++)
+            {
+                double value;
+                const char *separator = d + 1 < DERIVED_COUNTER_COUNT ? ", " : "";
+                if (derived_counter(s, d, &value))
+                    fprintf(file, "\"%s\": %.4f%s", derived_names[d], value, separator);
+                else
+                    fprintf(file, "\"%s\": null%s", derived_names[d], separator);
+            }
+            fprintf(file, "}");
+        }
+        fprintf(file, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static int write_csv(const char *path, const BenchmarkStats *results, int count, int width, int height, int threads)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s for writing\n", path);
+        return -1;
+    }
+
+    double pixels = (double)width * height;
+    fprintf(file, "case,width,height,threads,frames,median_ms,p95_ms,mean_ms,stddev_ms,min_ms,max_ms,"
+                  "samples_per_frame,samples_per_second,pixels_per_second,rays_per_frame");
+    for (int d = 0; d < DERIVED_COUNTER_COUNT; d++)
+        fprintf(file, ",%s", derived_names[d]);
+    fprintf(file, "\n");
+
+    for (int i = 0; i < count; i++)
+    {
+        const BenchmarkStats *s = &results[i];
+        fprintf(file, "%s,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.0f,%.0f,%.0f,%.0f", s->name, width, height,
+                threads, s->frames, s->median * 1e3, s->p95 * 1e3, s->mean * 1e3, s->stddev * 1e3, s->min * 1e3,
+                s->max * 1e3, s->samples_per_frame, s->samples_per_frame / s->median, pixels / s->median,
+                s->rays_per_frame);
+
+        // Counter columns stay empty where unavailable
+        for (int d = 0; d < DERIVED_COUNTER_COUNT; d++)
+        {
+            double value;
+            if (derived_counter(s, d, &value))
+                fprintf(file, ",%.4f", value);
+            else
+                fprintf(file, ",");
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+// Rays of the last frame: every ray type when the renderer counts them
+// (RAYTRACING_STATS builds, advanced cases), else the camera samples
+static double frame_rays(const RenderContext *context, unsigned long long samples)
+{
+    unsigned long long rays = 0;
+    for (int type = 0; type < RAY_TYPE_COUNT; type++)
+        rays += context->stats.rays[type];
+    return (double)(rays > 0 ? rays : samples);
+}
+
+// Warm up, then time repeat frames of one case. counters (may be NULL)
+// run across the timed frames only.
+static void run_case(BenchmarkCase bench_case, RenderContext *context, Framebuffer *framebuffer, Scene *scene,
+                     Camera *camera, int warmup, int repeat, double *times, PerfCounters *counters,
+                     BenchmarkStats *stats)
+{
+    for (int i = 0; i < warmup; i++)
+        run_frame(bench_case, context, framebuffer, scene, camera);
+
+    double samples = 0.0;
+    double rays = 0.0;
+    if (counters)
+        perf_counters_start(counters);
+    for (int i = 0; i < repeat; i++)
+    {
+        memset(&context->stats, 0, sizeof(context->stats)); // cases without a render context count nothing
+        double start = timer_seconds();
+        unsigned long long frame_samples = run_frame(bench_case, context, framebuffer, scene, camera);
+        times[i] = timer_seconds() - start;
+        samples += (double)frame_samples;
+        rays += frame_rays(context, frame_samples);
+    }
+
+    memset(&stats->counters, 0, sizeof(stats->counters));
+    if (counters)
+        perf_counters_stop(counters, &stats->counters);
+
+    stats->name = case_names[bench_case];
+    stats->samples_per_frame = samples / repeat;
+    stats->rays_per_frame = rays / repeat;
+    compute_stats(times, repeat, stats);
+}
+
+// Parse a comma separated list of positive integers; returns the count, or 0 on error
+static int parse_int_list(const char *text, int *values, int max_values)
+{
+    int count = 0;
+    while (*text && count < max_values)
+    {
+        char *end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value <= 0 || (*end != ',' && *end != '\0'))
+            return 0;
+        values[count++] = (int)value;
+        text = *end ? end + 1 : end;
+    }
+    return *text ? 0 : count;
+}
+
+// Parse "640x480,1280x720"; returns the count, or 0 on error
+static int parse_resolution_list(const char *text, int *widths, int *heights, int max_values)
+{
+    int count = 0;
+    while (*text && count < max_values)
+    {
+        int consumed = 0;
+        if (sscanf(text, "%dx%d%n", &widths[count], &heights[count], &consumed) != 2 ||
+            widths[count] <= 0 || heights[count] <= 0 || (text[consumed] != ',' && text[consumed] != '\0'))
+            return 0;
+        text += consumed;
+        count++;
+        if (*text == ',')
+            text++;
+    }
+    return *text ? 0 : count;
+}
+
+// Horizontal bars of the median frame time on a log scale, so sweeps over
+// several orders of magnitude stay readable
+static void print_scaling_chart(const ScalingPoint *points, int count)
+{
+    double low = points[0].stats.median;
+    double high = points[0].stats.median;
+    for (int i = 1; i < count; i++)
+    {
+        low = fmin(low, points[i].stats.median);
+        high = fmax(high, points[i].stats.median);
+    }
+
+    double span = log10(high / low);
+    printf("\nMedian time per frame (log scale, %.3f to %.3f ms):\n", low * 1e3, high * 1e3);
+    for (int i = 0; i < count; i++)
+    {
+        const ScalingPoint *p = &points[i];
+        int bar = 1 + (span > 0.0 ? (int)(49.0 * log10(p->stats.median / low) / span + 0.5) : 0);
+        printf("%9d sph %d lt %5dx%-5d |", p->spheres, p->lights, p->width, p->height);
+        for (int j = 0; j < bar; j++)
+            putchar('#');
+        printf(" %.3f ms\n", p->stats.median * 1e3);
+    }
+}
+
+static int write_scaling_json(const char *path, const ScalingPoint *points, int count, const char *case_name,
+                              SceneKind kind, Uint32 seed, int threads, int warmup)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s for writing\n", path);
+        return -1;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"case\": \"%s\",\n  \"scene_kind\": \"%s\",\n  \"seed\": %u,\n", case_name,
+            scene_kind_name(kind), (unsigned)seed);
+    fprintf(file, "  \"threads\": %d,\n  \"warmup\": %d,\n  \"math_backend\": \"%s\",\n", threads, warmup,
+            VECTOR_MATH_BACKEND);
+    fprintf(file, "  \"points\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const ScalingPoint *p = &points[i];
+        const BenchmarkStats *s = &p->stats;
+        fprintf(file, "    {\"spheres\": %d, \"lights\": %d, \"width\": %d, \"height\": %d, \"build_ms\": %.4f, "
+                      "\"frames\": %d, \"median_ms\": %.4f, \"p95_ms\": %.4f, \"stddev_ms\": %.4f, "
+                      "\"samples_per_second\": %.0f}%s\n",
+                p->spheres, p->lights, p->width, p->height, p->build * 1e3, s->frames, s->median * 1e3,
+                s->p95 * 1e3, s->stddev * 1e3, s->samples_per_frame / s->median, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static int write_scaling_csv(const char *path, const ScalingPoint *points, int count, const char *case_name,
+                             SceneKind kind, int threads)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s for writing\n", path);
+        return -1;
+    }
+
+    fprintf(file, "case,scene_kind,threads,spheres,lights,width,height,build_ms,frames,median_ms,p95_ms,stddev_ms,"
+                  "samples_per_second\n");
+    for (int i = 0; i < count; i++)
+    {
+        const ScalingPoint *p = &points[i];
+        const BenchmarkStats *s = &p->stats;
+        fprintf(file, "%s,%s,%d,%d,%d,%d,%d,%.4f,%d,%.4f,%.4f,%.4f,%.0f\n", case_name, scene_kind_name(kind), threads,
+                p->spheres, p->lights, p->width, p->height, p->build * 1e3, s->frames, s->median * 1e3, s->p95 * 1e3,
+                s->stddev * 1e3, s->samples_per_frame / s->median);
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+// Sweep every combination of sphere count, light count and resolution
+static int run_scaling(BenchmarkCase bench_case, RenderContext *context, SceneKind kind, Uint32 seed,
+                       const int *sizes, int size_count, const int *lights, int light_count,
+                       const int *widths, const int *heights, int resolution_count,
+                       int warmup, int repeat, double *times, const char *json_path, const char *csv_path)
+{
+    int total = size_count * light_count * resolution_count;
+    ScalingPoint *points = (ScalingPoint *)malloc(sizeof(ScalingPoint) * (size_t)total);
+    if (!points)
+        return 1;
+
+    int threads = thread_pool_size(context->thread_pool);
+    printf("Scaling %s on %s scenes (seed %u), %d threads, %s math, %d warmup + %d timed frames per point\n",
+           case_names[bench_case], scene_kind_name(kind), (unsigned)seed, threads, VECTOR_MATH_BACKEND, warmup, repeat);
+    printf("%9s | %6s | %11s | %10s | %10s | %10s | %14s\n", "Spheres", "Lights", "Resolution", "Build ms",
+           "Median ms", "p95 ms", "Samples/sec");
+    printf("----------|--------|-------------|------------|------------|------------|---------------\n");
+
+    int count = 0;
+    int status = 0;
+    for (int s = 0; s < size_count && status == 0; s++)
+    {
+        for (int l = 0; l < light_count && status == 0; l++)
+        {
+            Camera camera;
+            double start = timer_seconds();
+            Scene *scene = scene_generate(kind, sizes[s], lights[l], seed, &camera);
+            if (!scene || !scene_update_bvh(scene))
+            {
+                fprintf(stderr, "Failed to generate a %d sphere scene\n", sizes[s]);
+                scene_destroy(scene);
+                status = 1;
+                break;
+            }
+            double build = timer_seconds() - start;
+
+            for (int r = 0; r < resolution_count; r++)
+            {
+                Framebuffer *framebuffer = framebuffer_create(widths[r], heights[r]);
+                if (!framebuffer)
+                {
+                    fprintf(stderr, "Failed to allocate a %dx%d render target\n", widths[r], heights[r]);
+                    status = 1;
+                    break;
+                }
+                camera.aspect_ratio = (float)widths[r] / (float)heights[r];
+
+                ScalingPoint *point = &points[count++];
+                point->spheres = sizes[s];
+                point->lights = scene->light_count;
+                point->width = widths[r];
+                point->height = heights[r];
+                point->build = build;
+                run_case(bench_case, context, framebuffer, scene, &camera, warmup, repeat, times, NULL, &point->stats);
+                framebuffer_destroy(framebuffer);
+
+                printf("%9d | %6d | %5dx%-5d | %10.3f | %10.3f | %10.3f | %14.0f\n", point->spheres, point->lights,
+                       point->width, point->height, point->build * 1e3, point->stats.median * 1e3,
+                       point->stats.p95 * 1e3, point->stats.samples_per_frame / point->stats.median);
+            }
+            scene_destroy(scene);
+        }
+    }
+
+    if (count > 0)
+        print_scaling_chart(points, count);
+    if (json_path && write_scaling_json(json_path, points, count, case_names[bench_case], kind, seed, threads,
+                                        warmup) != 0)
+        status = 1;
+    if (csv_path && write_scaling_csv(csv_path, points, count, case_names[bench_case], kind, threads) != 0)
+        status = 1;
+
+    free(points);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *scene_path = NULL;
+    const char *json_path = NULL;
+    const char *csv_path = NULL;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    int thread_count = 0;
+    int warmup = 2;
+    int repeat = 10;
+    bool selected[BENCH_CASE_COUNT] = {false};
+    bool any_selected = false;
+    bool generate = false;
+    bool scaling = false;
+    bool use_counters = false;
+    SceneKind kind = SCENE_FIELD;
+    int sphere_count = 1000;
+    int light_count = 0;
+    Uint32 seed = 1;
+    int sizes[MAX_SWEEP_VALUES] = {10, 100, 1000, 10000, 100000};
+    int size_count = 5;
+    int lights[MAX_SWEEP_VALUES] = {2};
+    int lights_count = 1;
+    int widths[MAX_SWEEP_VALUES] = {320};
+    int heights[MAX_SWEEP_VALUES] = {240};
+    int resolution_count = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if ((strcmp(arg, "-w") == 0 || strcmp(arg, "--width") == 0) && has_value)
+            width = atoi(argv[++i]);
+        else if ((strcmp(arg, "-h") == 0 || strcmp(arg, "--height") == 0) && has_value)
+            height = atoi(argv[++i]);
+        else if ((strcmp(arg, "-t") == 0 || strcmp(arg, "--threads") == 0) && has_value)
+            thread_count = atoi(argv[++i]);
+        else if (strcmp(arg, "--warmup") == 0 && has_value)
+            warmup = atoi(argv[++i]);
+        else if (strcmp(arg, "--repeat") == 0 && has_value)
+            repeat = atoi(argv[++i]);
+        else if (strcmp(arg, "--json") == 0 && has_value)
+            json_path = argv[++i];
+        else if (strcmp(arg, "--csv") == 0 && has_value)
+            csv_path = argv[++i];
+        else if (strcmp(arg, "--generate") == 0 && has_value)
+        {
+            if (!scene_kind_parse(argv[++i], &kind))
+            {
+                fprintf(stderr, "Unknown scene kind: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            generate = true;
+        }
+        else if (strcmp(arg, "--spheres") == 0 && has_value)
+            sphere_count = atoi(argv[++i]);
+        else if (strcmp(arg, "--lights") == 0 && has_value)
+            light_count = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && has_value)
+            seed = (Uint32)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--scaling") == 0)
+            scaling = true;
+        else if (strcmp(arg, "--counters") == 0)
+            use_counters = true;
+        else if (strcmp(arg, "--sizes") == 0 && has_value)
+            size_count = parse_int_list(argv[++i], sizes, MAX_SWEEP_VALUES);
+        else if (strcmp(arg, "--light-counts") == 0 && has_value)
+            lights_count = parse_int_list(argv[++i], lights, MAX_SWEEP_VALUES);
+        else if (strcmp(arg, "--resolutions") == 0 && has_value)
+            resolution_count = parse_resolution_list(argv[++i], widths, heights, MAX_SWEEP_VALUES);
+        else if (strcmp(arg, "--case") == 0 && has_value)
+        {
+            const char *name = argv[++i];
+            int c = 0;
+            while (c < BENCH_CASE_COUNT && strcmp(case_names[c], name) != 0)
+                c++;
+            if (c == BENCH_CASE_COUNT)
+            {
+                fprintf(stderr, "Unknown benchmark case: %s\n", name);
+                print_usage(argv[0]);
+                return 1;
+            }
+            selected[c] = true;
+            any_selected = true;
+        }
+        else if (strcmp(arg, "--help") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] != '-' && !scene_path)
+            scene_path = arg;
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (width <= 0 || height <= 0 || warmup < 0 || repeat <= 0 || sphere_count <= 0 || size_count == 0 ||
+        lights_count == 0 || resolution_count == 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The basic path always looks down -z from the camera position with a
+    // fixed field of view, so it only shows the same view as the other cases
+    // in the default scene
+    bool custom_scene = generate || scene_path || scaling;
+    if (selected[BENCH_BASIC] && custom_scene)
+    {
+        fprintf(stderr, "The basic case has a fixed view and cannot follow the camera of --generate, --scaling "
+                        "or a scene file\n");
+        return 1;
+    }
+
+    if (scaling)
+    {
+        // The first selected case, advanced by default; rasterization ignores the scene
+        BenchmarkCase bench_case = BENCH_ADVANCED;
+        for (int c = BENCH_CASE_COUNT - 1; c >= 0; c--)
+        {
+            if (selected[c])
+                bench_case = (BenchmarkCase)c;
+        }
+        if (bench_case == BENCH_RASTERIZATION)
+        {
+            fprintf(stderr, "The rasterization case does not depend on the scene\n");
+            return 1;
+        }
+
+        if (use_counters)
+            fprintf(stderr, "--counters is ignored with --scaling\n");
+
+        RenderContext *context = render_context_create(thread_count);
+        double *times = (double *)malloc(sizeof(double) * (size_t)repeat);
+        int status = 1;
+        if (context && times)
+        {
+            status = run_scaling(bench_case, context, kind, seed, sizes, size_count, lights, lights_count, widths,
+                                 heights, resolution_count, warmup, repeat, times, json_path, csv_path);
+        }
+        free(times);
+        render_context_destroy(context);
+        return status;
+    }
+
+    Camera camera = camera_create(
+        vector3_create(0.0f, 0.0f, 0.0f),
+        vector3_create(0.0f, 0.0f, -1.0f),
+        vector3_create(0.0f, 1.0f, 0.0f),
+        45.0f);
+
+    Scene *scene = generate     ? scene_generate(kind, sphere_count, light_count, seed, &camera)
+                   : scene_path ? scene_load(scene_path, &camera)
+                                : create_default_scene();
+    if (!scene)
+    {
+        fprintf(stderr, "Failed to create scene\n");
+        return 1;
+    }
+    camera.aspect_ratio = (float)width / (float)height;
+
+    // Opened before the render threads start so the counters follow them too
+    PerfCounters counters;
+    bool have_counters = use_counters && perf_counters_open(&counters) > 0;
+
+    Framebuffer *framebuffer = framebuffer_create(width, height);
+    RenderContext *context = render_context_create(thread_count);
+    double *times = (double *)malloc(sizeof(double) * (size_t)repeat);
+    if (!framebuffer || !context || !times)
+    {
+        fprintf(stderr, "Failed to allocate a %dx%d render target\n", width, height);
+        if (have_counters)
+            perf_counters_close(&counters);
+        free(times);
+        render_context_destroy(context);
+        framebuffer_destroy(framebuffer);
+        scene_destroy(scene);
+        return 1;
+    }
+
+    int threads = thread_pool_size(context->thread_pool);
+    char scene_name[256];
+    if (generate)
+        snprintf(scene_name, sizeof(scene_name), "%s:%d:%u", scene_kind_name(kind), sphere_count, (unsigned)seed);
+    else
+        snprintf(scene_name, sizeof(scene_name), "%s", scene_path ? scene_path : "default");
+
+    printf("Benchmarking %s at %dx%d, %d threads, %s math, %d warmup + %d timed frames per case\n",
+           scene_name, width, height, threads, VECTOR_MATH_BACKEND, warmup, repeat);
+    printf("%-16s | %10s | %10s | %10s | %14s | %14s\n", "Case", "Median ms", "p95 ms", "Stddev ms",
+           "Samples/sec", "Pixels/sec");
+    printf("-----------------|------------|------------|------------|----------------|---------------\n");
+
+    BenchmarkStats results[BENCH_CASE_COUNT];
+    int result_count = 0;
+    double medians[BENCH_CASE_COUNT] = {0.0};
+
+    for (int c = 0; c < BENCH_CASE_COUNT; c++)
+    {
+        if ((any_selected && !selected[c]) || (c == BENCH_BASIC && custom_scene))
+            continue;
+
+        BenchmarkStats *stats = &results[result_count++];
+        run_case((BenchmarkCase)c, context, framebuffer, scene, &camera, warmup, repeat, times,
+                 have_counters ? &counters : NULL, stats);
+
+        printf("%-16s | %10.3f | %10.3f | %10.3f | %14.0f | %14.0f\n", stats->name, stats->median * 1e3,
+               stats->p95 * 1e3, stats->stddev * 1e3, stats->samples_per_frame / stats->median,
+               (double)width * height / stats->median);
+        medians[c] = stats->median;
+    }
+
+    if (medians[BENCH_WAVEFRONT] > 0.0 && medians[BENCH_WAVEFRONT_SORTED] > 0.0)
+        printf("Ray sorting speedup: %.2fx\n", medians[BENCH_WAVEFRONT] / medians[BENCH_WAVEFRONT_SORTED]);
+
+    if (have_counters)
+        print_counter_table(results, result_count);
+
+    int status = 0;
+    if (json_path && write_json(json_path, results, result_count, width, height, threads, warmup, scene_name) != 0)
+        status = 1;
+    if (csv_path && write_csv(csv_path, results, result_count, width, height, threads) != 0)
+        status = 1;
+
+    if (have_counters)
+        perf_counters_close(&counters);
+    free(times);
+    render_context_destroy(context);
+    framebuffer_destroy(framebuffer);
+    scene_destroy(scene);
+    return status;
+}
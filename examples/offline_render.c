@@ -0,0 +1,185 @@
+#include "../include/raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Headless renderer: reads a scene file, renders it once and writes an image.
+// Built with RAYTRACING_HEADLESS, so it never links or initializes SDL.
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options] scene_file\n", program);
+    printf("  -o, --output FILE     Output image (.ppm, .pfm or .png, default render.ppm)\n");
+    printf("  -w, --width N         Image width in pixels (default %d)\n", WINDOW_WIDTH);
+    printf("  -h, --height N        Image height in pixels (default %d)\n", WINDOW_HEIGHT);
+    printf("  -s, --samples N       Anti-aliasing samples per pixel (default 1 = off)\n");
+    printf("  -t, --threads N       Render threads (default: one per CPU)\n");
+    printf("  -a, --adaptive T      Adaptive AA: 2 samples, all N where channels differ by more than T\n");
+    printf("      --no-shadows      Disable shadow rays\n");
+    printf("      --no-reflections  Disable reflection rays\n");
+    printf("  -d, --max-depth N     Reflection bounces per path (default %d)\n", MAX_REFLECTIONS);
+    printf("  -r, --roulette T      Russian roulette below path throughput T instead of a fixed cutoff\n");
+    printf("      --wavefront       Trace tiles stage by stage instead of path by path\n");
+    printf("      --sort-rays       With --wavefront, sort bounce rays by direction and origin\n");
+    printf("      --exposure EV     Scale colors by 2^EV before writing 8-bit images\n");
+    printf("      --tone CURVE      Tone curve for 8-bit images: clamp (default), reinhard or aces\n");
+    printf("      --srgb            Encode 8-bit images with the sRGB transfer curve\n");
+    printf("      --dither          Ordered dither when quantizing to 8 bits\n");
+    printf("      --stats           Print ray and intersection counts (RAYTRACING_STATS builds)\n");
+    printf("      --trace FILE      Write a Chrome trace JSON timeline of the render\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *scene_path = NULL;
+    const char *output_path = "render.ppm";
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    int thread_count = 0;
+    bool print_stats = false;
+    const char *trace_path = NULL;
+
+    RenderSettings settings = {
+        .enable_shadows = true,
+        .enable_reflections = true,
+        .enable_anti_aliasing = false,
+        .samples_per_pixel = 1,
+        .reflection_strength = 0.3f};
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) && has_value)
+            output_path = argv[++i];
+        else if ((strcmp(arg, "-w") == 0 || strcmp(arg, "--width") == 0) && has_value)
+            width = atoi(argv[++i]);
+        else if ((strcmp(arg, "-h") == 0 || strcmp(arg, "--height") == 0) && has_value)
+            height = atoi(argv[++i]);
+        else if ((strcmp(arg, "-s") == 0 || strcmp(arg, "--samples") == 0) && has_value)
+            settings.samples_per_pixel = atoi(argv[++i]);
+        else if ((strcmp(arg, "-t") == 0 || strcmp(arg, "--threads") == 0) && has_value)
+            thread_count = atoi(argv[++i]);
+        else if ((strcmp(arg, "-a") == 0 || strcmp(arg, "--adaptive") == 0) && has_value)
+        {
+            settings.enable_adaptive_aa = true;
+            settings.adaptive_min_samples = 2;
+            settings.adaptive_threshold = (float)atof(argv[++i]);
+        }
+        else if ((strcmp(arg, "-d") == 0 || strcmp(arg, "--max-depth") == 0) && has_value)
+            settings.max_depth = atoi(argv[++i]);
+        else if ((strcmp(arg, "-r") == 0 || strcmp(arg, "--roulette") == 0) && has_value)
+            settings.roulette_threshold = (float)atof(argv[++i]);
+        else if (strcmp(arg, "--wavefront") == 0)
+            settings.enable_wavefront = true;
+        else if (strcmp(arg, "--sort-rays") == 0)
+            settings.enable_ray_sorting = true;
+        else if (strcmp(arg, "--exposure") == 0 && has_value)
+            settings.tone_map.exposure = (float)atof(argv[++i]);
+        else if (strcmp(arg, "--tone") == 0 && has_value && strcmp(argv[i + 1], "clamp") == 0)
+        {
+            settings.tone_map.curve = TONE_CURVE_CLAMP;
+            i++;
+        }
+        else if (strcmp(arg, "--tone") == 0 && has_value && strcmp(argv[i + 1], "reinhard") == 0)
+        {
+            settings.tone_map.curve = TONE_CURVE_REINHARD;
+            i++;
+        }
+        else if (strcmp(arg, "--tone") == 0 && has_value && strcmp(argv[i + 1], "aces") == 0)
+        {
+            settings.tone_map.curve = TONE_CURVE_ACES;
+            i++;
+        }
+        else if (strcmp(arg, "--srgb") == 0)
+            settings.tone_map.srgb = true;
+        else if (strcmp(arg, "--dither") == 0)
+            settings.tone_map.dither = true;
+        else if (strcmp(arg, "--stats") == 0)
+            print_stats = true;
+        else if (strcmp(arg, "--trace") == 0 && has_value)
+            trace_path = argv[++i];
+        else if (strcmp(arg, "--no-shadows") == 0)
+            settings.enable_shadows = false;
+        else if (strcmp(arg, "--no-reflections") == 0)
+            settings.enable_reflections = false;
+        else if (strcmp(arg, "--help") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] != '-' && !scene_path)
+            scene_path = arg;
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!scene_path || width <= 0 || height <= 0 || settings.samples_per_pixel <= 0 || settings.max_depth < 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    settings.enable_anti_aliasing = settings.samples_per_pixel > 1;
+
+    // Default camera, overridden by a "camera" line in the scene file
+    Camera camera = camera_create(
+        vector3_create(0.0f, 0.0f, 0.0f),
+        vector3_create(0.0f, 0.0f, -1.0f),
+        vector3_create(0.0f, 1.0f, 0.0f),
+        45.0f);
+
+    Scene *scene = scene_load(scene_path, &camera);
+    if (!scene)
+    {
+        return 1;
+    }
+    camera.aspect_ratio = (float)width / (float)height;
+
+    Framebuffer *framebuffer = framebuffer_create(width, height);
+    RenderContext *context = render_context_create(thread_count);
+    if (!framebuffer || !framebuffer_enable_hdr(framebuffer) || !context)
+    {
+        fprintf(stderr, "Failed to allocate a %dx%d render target\n", width, height);
+        render_context_destroy(context);
+        framebuffer_destroy(framebuffer);
+        scene_destroy(scene);
+        return 1;
+    }
+
+    printf("Rendering %s at %dx%d, %d sample(s) per pixel, %d threads...\n", scene_path, width, height,
+           settings.samples_per_pixel, thread_pool_size(context->thread_pool));
+
+    if (trace_path)
+    {
+        trace_set_thread_name("main", -1);
+        trace_start();
+    }
+
+    double start = timer_seconds();
+    render_scene_advanced(context, framebuffer, scene, &camera, &settings);
+    double elapsed = timer_seconds() - start;
+    trace_stop();
+
+    printf("Rendered in %.3f seconds (%.0f pixels/sec, %llu camera samples, %.2f per pixel)\n", elapsed,
+           (double)width * height / elapsed, context->samples_traced,
+           (double)context->samples_traced / ((double)width * height));
+    if (print_stats)
+        render_stats_print(&context->stats, stdout);
+
+    int status = image_write(output_path, framebuffer) == 0 ? 0 : 1;
+    if (status == 0)
+    {
+        printf("Wrote %s\n", output_path);
+    }
+    if (trace_path && trace_write(trace_path) != 0)
+        status = 1;
+
+    render_context_destroy(context);
+    framebuffer_destroy(framebuffer);
+    scene_destroy(scene);
+    return status;
+}
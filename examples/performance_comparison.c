@@ -1,5 +1,6 @@
 #include "../include/raytracing.h"
-#include <time.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Performance benchmark structure
 typedef struct
@@ -10,52 +11,49 @@ typedef struct
     float fps;
 } BenchmarkResult;
 
-void benchmark_simple_rasterization(SDL_Renderer *renderer, BenchmarkResult *result)
+void benchmark_simple_rasterization(SDL_Renderer *renderer, SDL_Texture *texture, Framebuffer *framebuffer, BenchmarkResult *result)
 {
-    clock_t start = clock();
+    Uint64 start = SDL_GetPerformanceCounter();
     Vector3 light_pos = vector3_create(400, 200, 100);
 
     // Clear screen
-    SDL_SetRenderDrawColor(renderer, 20, 20, 40, 255);
-    SDL_RenderClear(renderer);
+    framebuffer_clear(framebuffer, 20, 20, 40);
 
     // Draw multiple spheres
-    draw_sphere_simple(renderer, 200, 150, 80, light_pos);
-    draw_sphere_simple(renderer, 400, 200, 60, light_pos);
-    draw_sphere_simple(renderer, 600, 250, 100, light_pos);
-    draw_sphere_simple(renderer, 300, 350, 70, light_pos);
+    draw_sphere_simple(framebuffer, 200, 150, 80, light_pos);
+    draw_sphere_simple(framebuffer, 400, 200, 60, light_pos);
+    draw_sphere_simple(framebuffer, 600, 250, 100, light_pos);
+    draw_sphere_simple(framebuffer, 300, 350, 70, light_pos);
 
+    framebuffer_blit(renderer, texture, framebuffer);
     SDL_RenderPresent(renderer);
 
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    Uint64 end = SDL_GetPerformanceCounter();
+    result->render_time = (float)((double)(end - start) / SDL_GetPerformanceFrequency());
     result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
     result->fps = 1.0f / result->render_time;
     result->name = "Simple Rasterization";
 }
 
-void benchmark_basic_raytracing(SDL_Renderer *renderer, Scene *scene, BenchmarkResult *result)
+void benchmark_basic_raytracing(SDL_Renderer *renderer, SDL_Texture *texture, Framebuffer *framebuffer, Scene *scene, BenchmarkResult *result)
 {
-    clock_t start = clock();
+    Uint64 start = SDL_GetPerformanceCounter();
     Vector3 camera_pos = vector3_create(0, 0, 0);
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene(renderer, scene, camera_pos);
+    render_scene(framebuffer, scene, camera_pos);
+    framebuffer_blit(renderer, texture, framebuffer);
     SDL_RenderPresent(renderer);
 
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    Uint64 end = SDL_GetPerformanceCounter();
+    result->render_time = (float)((double)(end - start) / SDL_GetPerformanceFrequency());
     result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
     result->fps = 1.0f / result->render_time;
     result->name = "Basic Raytracing";
 }
 
-void benchmark_advanced_raytracing(SDL_Renderer *renderer, Scene *scene, Camera *camera, BenchmarkResult *result)
+void benchmark_advanced_raytracing(SDL_Renderer *renderer, SDL_Texture *texture, RenderContext *context, Framebuffer *framebuffer, Scene *scene, Camera *camera, BenchmarkResult *result)
 {
-    clock_t start = clock();
+    Uint64 start = SDL_GetPerformanceCounter();
 
     RenderSettings settings = {
         .enable_shadows = true,
@@ -64,23 +62,20 @@ void benchmark_advanced_raytracing(SDL_Renderer *renderer, Scene *scene, Camera
         .samples_per_pixel = 1,
         .reflection_strength = 0.3f};
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene_advanced(renderer, scene, camera, &settings);
+    render_scene_advanced(context, framebuffer, scene, camera, &settings);
+    framebuffer_blit(renderer, texture, framebuffer);
     SDL_RenderPresent(renderer);
 
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    Uint64 end = SDL_GetPerformanceCounter();
+    result->render_time = (float)((double)(end - start) / SDL_GetPerformanceFrequency());
     result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
     result->fps = 1.0f / result->render_time;
     result->name = "Advanced Raytracing (Shadows + Reflections)";
 }
 
-void benchmark_anti_aliased_raytracing(SDL_Renderer *renderer, Scene *scene, Camera *camera, BenchmarkResult *result)
+void benchmark_anti_aliased_raytracing(SDL_Renderer *renderer, SDL_Texture *texture, RenderContext *context, Framebuffer *framebuffer, Scene *scene, Camera *camera, BenchmarkResult *result)
 {
-    clock_t start = clock();
+    Uint64 start = SDL_GetPerformanceCounter();
 
     RenderSettings settings = {
         .enable_shadows = true,
@@ -89,20 +84,42 @@ void benchmark_anti_aliased_raytracing(SDL_Renderer *renderer, Scene *scene, Cam
         .samples_per_pixel = 4,
         .reflection_strength = 0.3f};
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene_advanced(renderer, scene, camera, &settings);
+    render_scene_advanced(context, framebuffer, scene, camera, &settings);
+    framebuffer_blit(renderer, texture, framebuffer);
     SDL_RenderPresent(renderer);
 
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    Uint64 end = SDL_GetPerformanceCounter();
+    result->render_time = (float)((double)(end - start) / SDL_GetPerformanceFrequency());
     result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT * settings.samples_per_pixel;
     result->fps = 1.0f / result->render_time;
     result->name = "Anti-Aliased Raytracing (4x MSAA)";
 }
 
+void benchmark_adaptive_raytracing(SDL_Renderer *renderer, SDL_Texture *texture, RenderContext *context, Framebuffer *framebuffer, Scene *scene, Camera *camera, BenchmarkResult *result)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    RenderSettings settings = {
+        .enable_shadows = true,
+        .enable_reflections = true,
+        .enable_anti_aliasing = true,
+        .samples_per_pixel = 4,
+        .reflection_strength = 0.3f,
+        .enable_adaptive_aa = true,
+        .adaptive_min_samples = 2,
+        .adaptive_threshold = 0.05f};
+
+    render_scene_advanced(context, framebuffer, scene, camera, &settings);
+    framebuffer_blit(renderer, texture, framebuffer);
+    SDL_RenderPresent(renderer);
+
+    Uint64 end = SDL_GetPerformanceCounter();
+    result->render_time = (float)((double)(end - start) / SDL_GetPerformanceFrequency());
+    result->total_pixels = (int)context->samples_traced;
+    result->fps = 1.0f / result->render_time;
+    result->name = "Adaptive Anti-Aliasing (2-4 samples)";
+}
+
 void print_benchmark_results(BenchmarkResult *results, int count)
 {
     printf("\n==== GRAPHICS RENDERING PERFORMANCE COMPARISON ====\n");
@@ -127,7 +144,7 @@ void print_benchmark_results(BenchmarkResult *results, int count)
     printf("- Anti-aliasing significantly improves quality at high performance cost\n");
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     SDL_Window *window = NULL;
     SDL_Renderer *renderer = NULL;
@@ -137,11 +154,43 @@ int main()
         return 1;
     }
 
+    // Create framebuffer and its streaming texture
+    Framebuffer *framebuffer = framebuffer_create(WINDOW_WIDTH, WINDOW_HEIGHT);
+    SDL_Texture *texture = framebuffer ? framebuffer_create_texture(renderer, framebuffer) : NULL;
+    if (!texture)
+    {
+        fprintf(stderr, "Failed to create framebuffer\n");
+        framebuffer_destroy(framebuffer);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
+
+    // Tiled renderer on every core, plus a single-threaded reference
+    RenderContext *context = render_context_create(parse_thread_count(argc, argv));
+    RenderContext *single_context = render_context_create(1);
+    Uint32 *threaded_pixels = (Uint32 *)malloc(sizeof(Uint32) * WINDOW_WIDTH * WINDOW_HEIGHT);
+    if (!context || !single_context || !threaded_pixels)
+    {
+        fprintf(stderr, "Failed to create render context\n");
+        free(threaded_pixels);
+        render_context_destroy(single_context);
+        render_context_destroy(context);
+        SDL_DestroyTexture(texture);
+        framebuffer_destroy(framebuffer);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
+
     // Create test scene
     Scene *scene = scene_create();
     if (!scene)
     {
         fprintf(stderr, "Failed to create scene\n");
+        free(threaded_pixels);
+        render_context_destroy(single_context);
+        render_context_destroy(context);
+        SDL_DestroyTexture(texture);
+        framebuffer_destroy(framebuffer);
         cleanup_graphics(window, renderer);
         return 1;
     }
@@ -173,13 +222,14 @@ int main()
     printf("This will render the same scene using different techniques.\n");
     printf("Press any key to continue between tests.\n\n");
 
-    BenchmarkResult results[4];
+    BenchmarkResult results[6];
+    char threaded_name[64];
     SDL_Event event;
     bool continue_benchmarks = true;
 
     // Benchmark 1: Simple Rasterization
     printf("1. Benchmarking Simple Rasterization...\n");
-    benchmark_simple_rasterization(renderer, &results[0]);
+    benchmark_simple_rasterization(renderer, texture, framebuffer, &results[0]);
     printf("   Completed in %.3f seconds (%.1f FPS)\n", results[0].render_time, results[0].fps);
 
     // Wait for user input
@@ -204,7 +254,7 @@ next1:
 
     // Benchmark 2: Basic Raytracing
     printf("\n2. Benchmarking Basic Raytracing...\n");
-    benchmark_basic_raytracing(renderer, scene, &results[1]);
+    benchmark_basic_raytracing(renderer, texture, framebuffer, scene, &results[1]);
     printf("   Completed in %.3f seconds (%.1f FPS)\n", results[1].render_time, results[1].fps);
 
     printf("   Press any key to continue...\n");
@@ -228,8 +278,22 @@ next2:
 
     // Benchmark 3: Advanced Raytracing
     printf("\n3. Benchmarking Advanced Raytracing (Shadows + Reflections)...\n");
-    benchmark_advanced_raytracing(renderer, scene, &camera, &results[2]);
-    printf("   Completed in %.3f seconds (%.1f FPS)\n", results[2].render_time, results[2].fps);
+    benchmark_advanced_raytracing(renderer, texture, single_context, framebuffer, scene, &camera, &results[2]);
+    results[2].name = "Advanced Raytracing (1 thread)";
+    printf("   1 thread:   %.3f seconds (%.1f FPS)\n", results[2].render_time, results[2].fps);
+    memcpy(threaded_pixels, framebuffer->pixels, sizeof(Uint32) * WINDOW_WIDTH * WINDOW_HEIGHT);
+
+    benchmark_advanced_raytracing(renderer, texture, context, framebuffer, scene, &camera, &results[3]);
+    snprintf(threaded_name, sizeof(threaded_name), "Advanced Raytracing (%d threads)",
+             thread_pool_size(context->thread_pool));
+    results[3].name = threaded_name;
+    printf("   %d threads: %.3f seconds (%.1f FPS, %.1fx speedup)\n",
+           thread_pool_size(context->thread_pool), results[3].render_time, results[3].fps,
+           results[2].render_time / results[3].render_time);
+    printf("   Threaded image %s the single-threaded image\n",
+           memcmp(threaded_pixels, framebuffer->pixels, sizeof(Uint32) * WINDOW_WIDTH * WINDOW_HEIGHT) == 0
+               ? "matches"
+               : "DIFFERS from");
 
     printf("   Press any key to continue...\n");
     while (continue_benchmarks)
@@ -253,11 +317,18 @@ next3:
     // Benchmark 4: Anti-Aliased Raytracing
     printf("\n4. Benchmarking Anti-Aliased Raytracing (4x MSAA)...\n");
     printf("   This may take a while...\n");
-    benchmark_anti_aliased_raytracing(renderer, scene, &camera, &results[3]);
-    printf("   Completed in %.3f seconds (%.1f FPS)\n", results[3].render_time, results[3].fps);
+    benchmark_anti_aliased_raytracing(renderer, texture, context, framebuffer, scene, &camera, &results[4]);
+    printf("   Completed in %.3f seconds (%.1f FPS)\n", results[4].render_time, results[4].fps);
+
+    // Benchmark 5: Adaptive Anti-Aliasing
+    printf("\n5. Benchmarking Adaptive Anti-Aliasing (2 samples, up to 4 on edges)...\n");
+    benchmark_adaptive_raytracing(renderer, texture, context, framebuffer, scene, &camera, &results[5]);
+    printf("   Completed in %.3f seconds (%.1f FPS)\n", results[5].render_time, results[5].fps);
+    printf("   Samples traced: %d of %d (%.1f%% of 4x MSAA)\n", results[5].total_pixels, results[4].total_pixels,
+           100.0f * results[5].total_pixels / results[4].total_pixels);
 
     // Print comprehensive results
-    print_benchmark_results(results, 4);
+    print_benchmark_results(results, 6);
 
     printf("\nPress any key to exit...\n");
     while (continue_benchmarks)
@@ -274,6 +345,11 @@ next3:
 
 cleanup:
     scene_destroy(scene);
+    free(threaded_pixels);
+    render_context_destroy(single_context);
+    render_context_destroy(context);
+    SDL_DestroyTexture(texture);
+    framebuffer_destroy(framebuffer);
     cleanup_graphics(window, renderer);
     return 0;
 }
\ No newline at end of file
@@ -26,12 +26,12 @@ void handle_raster_events(SDL_Event *event, bool *running, Vector3 *light_pos)
 }
 
 // Example demonstrating simple rasterization (from your original code)
-void rasterization_example(SDL_Renderer *renderer, Vector3 light_pos)
+void rasterization_example(Framebuffer *framebuffer, Vector3 light_pos)
 {
     // Draw multiple spheres with simple lighting
-    draw_sphere_simple(renderer, 200, 200, 80, light_pos);
-    draw_sphere_simple(renderer, 400, 300, 60, light_pos);
-    draw_sphere_simple(renderer, 600, 250, 100, light_pos);
+    draw_sphere_simple(framebuffer, 200, 200, 80, light_pos);
+    draw_sphere_simple(framebuffer, 400, 300, 60, light_pos);
+    draw_sphere_simple(framebuffer, 600, 250, 100, light_pos);
 }
 
 int main()
@@ -44,6 +44,16 @@ int main()
         return 1;
     }
 
+    Framebuffer *framebuffer = framebuffer_create(WINDOW_WIDTH, WINDOW_HEIGHT);
+    SDL_Texture *texture = framebuffer ? framebuffer_create_texture(renderer, framebuffer) : NULL;
+    if (!texture)
+    {
+        fprintf(stderr, "Failed to create framebuffer\n");
+        framebuffer_destroy(framebuffer);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
+
     bool running = true;
     SDL_Event event;
     Vector3 light_pos = vector3_create(400, 200, 100);
@@ -57,16 +67,18 @@ int main()
         handle_raster_events(&event, &running, &light_pos);
 
         // Clear screen
-        SDL_SetRenderDrawColor(renderer, 20, 20, 40, 255);
-        SDL_RenderClear(renderer);
+        framebuffer_clear(framebuffer, 20, 20, 40);
 
         // Render using rasterization
-        rasterization_example(renderer, light_pos);
+        rasterization_example(framebuffer, light_pos);
 
+        framebuffer_blit(renderer, texture, framebuffer);
         SDL_RenderPresent(renderer);
         SDL_Delay(16);
     }
 
+    SDL_DestroyTexture(texture);
+    framebuffer_destroy(framebuffer);
     cleanup_graphics(window, renderer);
     return 0;
 }
\ No newline at end of file
@@ -1,199 +1,166 @@
 #include "../include/raytracing.h"
-#include <time.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
-
-// Performance benchmark structure
+// Input state shared between the main thread, which handles events and
+// presents frames, and the render thread, which renders into a frame queue
+// with the latest copy it finds at the start of each frame
 typedef struct
 {
-    const char *name;
-    int total_pixels;
-    float render_time;
-    float fps;
-} BenchmarkResult;
-
-void benchmark_simple_rasterization(SDL_Renderer *renderer, BenchmarkResult *result)
-{
-    clock_t start = clock();
-    Vector3 light_pos = vector3_create(400, 200, 100);
-
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 20, 20, 40, 255);
-    SDL_RenderClear(renderer);
-
-    // Draw multiple spheres
-    draw_sphere_simple(renderer, 200, 150, 80, light_pos);
-    draw_sphere_simple(renderer, 400, 200, 60, light_pos);
-    draw_sphere_simple(renderer, 600, 250, 100, light_pos);
-    draw_sphere_simple(renderer, 300, 350, 70, light_pos);
-
-    SDL_RenderPresent(renderer);
-
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
-    result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
-    result->fps = 1.0f / result->render_time;
-    result->name = "Simple Rasterization";
-}
-
-void benchmark_basic_raytracing(SDL_Renderer *renderer, Scene *scene, BenchmarkResult *result)
-{
-    clock_t start = clock();
-    Vector3 camera_pos = vector3_create(0, 0, 0);
-
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene(renderer, scene, camera_pos);
-    SDL_RenderPresent(renderer);
-
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
-    result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
-    result->fps = 1.0f / result->render_time;
-    result->name = "Basic Raytracing";
-}
-
-void benchmark_advanced_raytracing(SDL_Renderer *renderer, Scene *scene, Camera *camera, BenchmarkResult *result)
-{
-    clock_t start = clock();
-
-    RenderSettings settings = {
-        .enable_shadows = true,
-        .enable_reflections = true,
-        .enable_anti_aliasing = false,
-        .samples_per_pixel = 1,
-        .reflection_strength = 0.5f};
-
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene_advanced(renderer, scene, camera, &settings);
-    SDL_RenderPresent(renderer);
-
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
-    result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT;
-    result->fps = 1.0f / result->render_time;
-    result->name = "Advanced Raytracing (Shadows + Reflections)";
-}
-
-void benchmark_anti_aliased_raytracing(SDL_Renderer *renderer, Scene *scene, Camera *camera, BenchmarkResult *result)
+    pthread_mutex_t lock;
+    pthread_cond_t input_changed; // signalled with each new input_version and on exit
+    Uint64 input_version;         // bumped whenever the inputs below change
+    RenderSettings settings;
+    Camera camera;
+    Vector3 light_position;
+    bool running;
+
+    RenderContext *context;
+    Scene *scene;
+    FrameQueue *frames;
+} RenderShared;
+
+static void *render_thread_main(void *arg)
 {
-    clock_t start = clock();
+    RenderShared *shared = (RenderShared *)arg;
+    trace_set_thread_name("render", -1);
 
-    RenderSettings settings = {
-        .enable_shadows = true,
-        .enable_reflections = true,
-        .enable_anti_aliasing = true,
-        .samples_per_pixel = 4,
-        .reflection_strength = 0.3f};
-
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    render_scene_advanced(renderer, scene, camera, &settings);
-    SDL_RenderPresent(renderer);
-
-    clock_t end = clock();
-    result->render_time = ((double)(end - start)) / CLOCKS_PER_SEC;
-    result->total_pixels = WINDOW_WIDTH * WINDOW_HEIGHT * settings.samples_per_pixel;
-    result->fps = 1.0f / result->render_time;
-    result->name = "Anti-Aliased Raytracing (4x MSAA)";
-}
-
-void print_benchmark_results(BenchmarkResult *results, int count)
-{
-    printf("\n==== GRAPHICS RENDERING PERFORMANCE COMPARISON ====\n");
-    printf("Resolution: %dx%d pixels\n", WINDOW_WIDTH, WINDOW_HEIGHT);
-    printf("%-40s | %10s | %8s | %12s\n", "Technique", "Time (s)", "FPS", "Pixels/sec");
-    printf("%-40s-|-%10s-|-%8s-|-%12s\n", "----------------------------------------",
-           "----------", "--------", "------------");
-
-    for (int i = 0; i < count; i++)
+    Uint64 rendered_version = 0;
+    bool refining = false;
+    while (true)
     {
-        float pixels_per_sec = results[i].total_pixels / results[i].render_time;
-        printf("%-40s | %10.3f | %8.1f | %12.0f\n",
-               results[i].name,
-               results[i].render_time,
-               results[i].fps,
-               pixels_per_sec);
+        // Sleep while the next frame would just repeat the last one: same
+        // inputs and no progressive samples left to add
+        pthread_mutex_lock(&shared->lock);
+        while (shared->running && shared->input_version == rendered_version && !refining)
+            pthread_cond_wait(&shared->input_changed, &shared->lock);
+        rendered_version = shared->input_version;
+        bool running = shared->running;
+        RenderSettings settings = shared->settings;
+        Camera camera = shared->camera;
+        Vector3 light_position = shared->light_position;
+        pthread_mutex_unlock(&shared->lock);
+        if (!running)
+            break;
+
+        Framebuffer *framebuffer = frame_queue_begin_write(shared->frames);
+        if (!framebuffer)
+            break;
+
+        shared->scene->lights[0].position = light_position;
+        render_scene_advanced(shared->context, framebuffer, shared->scene, &camera, &settings);
+        frame_queue_end_write(shared->frames, framebuffer);
+        refining = render_context_refining(shared->context, &settings);
     }
-    printf("\nKey Observations:\n");
-    printf("- Rasterization is fastest but least realistic\n");
-    printf("- Basic raytracing adds realistic lighting\n");
-    printf("- Advanced features (shadows, reflections) increase quality but reduce performance\n");
-    printf("- Anti-aliasing significantly improves quality at high performance cost\n");
+    return NULL;
 }
 
 int main(int argc, char *argv[])
 {
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    SDL_Window *window = NULL;
+    SDL_Renderer *renderer = NULL;
+
+    // Presentation options; --threads is read by parse_thread_count
+    bool vsync = false;
+    double target_fps = 60.0;
+    int buffer_count = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--vsync") == 0)
+            vsync = true;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            target_fps = atof(argv[++i]);
+        else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc)
+            buffer_count = atoi(argv[++i]);
+    }
+    if (target_fps <= 0.0)
     {
-        fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
+        fprintf(stderr, "--fps must be positive\n");
         return 1;
     }
 
-    SDL_Window *window = SDL_CreateWindow("Raytracing Performance Comparison",
-                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                          WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!window)
+    // Present on the display's refresh instead of a timer when asked
+    if (vsync)
+        SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
+
+    if (init_graphics(&window, &renderer) != 0)
     {
-        fprintf(stderr, "SDL_CreateWindow Error: %s\n", SDL_GetError());
-        SDL_Quit();
         return 1;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (!renderer)
+    // Frames rendered ahead of the display, and the texture they are shown through
+    FrameQueue *frames = frame_queue_create(WINDOW_WIDTH, WINDOW_HEIGHT, buffer_count);
+    Framebuffer frame_size = {.width = WINDOW_WIDTH, .height = WINDOW_HEIGHT};
+    SDL_Texture *texture = frames ? framebuffer_create_texture(renderer, &frame_size) : NULL;
+    if (!texture)
     {
-        fprintf(stderr, "SDL_CreateRenderer Error: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+        fprintf(stderr, "Failed to create framebuffers\n");
+        frame_queue_destroy(frames);
+        cleanup_graphics(window, renderer);
         return 1;
     }
 
-    // Create scene with multiple spheres and lights
+    // Tile renderer backed by a persistent worker pool
+    RenderContext *context = render_context_create(parse_thread_count(argc, argv));
+    if (!context)
+    {
+        fprintf(stderr, "Failed to create render context\n");
+        SDL_DestroyTexture(texture);
+        frame_queue_destroy(frames);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
+    context->frame_stats.report_interval = 2.0; // print render time percentiles every two seconds
+
+    // Create scene
     Scene *scene = scene_create();
+    if (!scene)
+    {
+        fprintf(stderr, "Failed to create scene\n");
+        render_context_destroy(context);
+        SDL_DestroyTexture(texture);
+        frame_queue_destroy(frames);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
 
+    // Set up materials with varying properties
     Material red_material = {
-        .color = color_create(1.0f, 0.2f, 0.2f),
-        .ambient = 0.1f,
-        .diffuse = 0.7f,
-        .specular = 0.5f,
-        .shininess = 32.0f};
-
-    Material green_material = {
-        .color = color_create(0.2f, 1.0f, 0.2f),
-        .ambient = 0.1f,
-        .diffuse = 0.7f,
-        .specular = 0.3f,
-        .shininess = 16.0f};
+        color_create(0.8f, 0.2f, 0.2f), // Bright red
+        0.1f,                           // ambient
+        0.8f,                           // diffuse
+        0.9f,                           // high specular for reflections
+        64.0f                           // high shininess
+    };
 
     Material blue_material = {
-        .color = color_create(0.2f, 0.2f, 1.0f),
-        .ambient = 0.1f,
-        .diffuse = 0.7f,
-        .specular = 0.4f,
-        .shininess = 8.0f};
+        color_create(0.2f, 0.2f, 0.8f), // Bright blue
+        0.1f, 0.7f, 0.8f, 128.0f        // Very reflective
+    };
+
+    Material green_material = {
+        color_create(0.2f, 0.8f, 0.2f), // Bright green
+        0.1f, 0.6f, 0.3f, 16.0f         // Matte finish
+    };
 
     Material metallic_material = {
-        .color = color_create(0.8f, 0.8f, 0.8f),
-        .ambient = 0.1f,
-        .diffuse = 0.5f,
-        .specular = 0.9f,
-        .shininess = 64.0f};
-    
-    scene_add_sphere(scene, vector3_create(-1.5f, 0.0f, -5.0f), 1.0f, red_material);
-    scene_add_sphere(scene, vector3_create(1.5f, 0.0f, -4.0f), 1.0f, green_material);
-    scene_add_sphere(scene, vector3_create(0.0f, -1.5f, -6.0f), 1.0f, blue_material);
-    scene_add_sphere(scene, vector3_create(0.0f, 1.5f, -7.0f), 1.0f, metallic_material);
-    scene_add_light(scene, vector3_create(5.0f, 5.0f, 0.0f), color_create(1.0f, 1.0f, 1.0f), 1.0f);
-    scene_add_light(scene, vector3_create(-3.0f, 5.0f, 2.0f), color_create(0.5f, 0.5f, 1.0f), 0.7f);
-    scene_add_light(scene, vector3_create(0.0f, -5.0f, 5.0f), color_create(1.0f, 0.8f, 0.6f), 0.5f);
-    scene->background = color_create(0.1f, 0.1f, 0.2f);
+        color_create(0.9f, 0.9f, 0.9f), // Metallic silver
+        0.05f, 0.3f, 0.95f, 256.0f      // Highly reflective
+    };
+
+    // Add spheres to scene with better positioning
+    scene_add_sphere(scene, vector3_create(0.0f, 0.0f, -5.0f), 1.0f, red_material);
+    scene_add_sphere(scene, vector3_create(-2.5f, 0.0f, -4.0f), 0.8f, blue_material);
+    scene_add_sphere(scene, vector3_create(2.5f, -1.0f, -6.0f), 1.2f, green_material);
+    scene_add_sphere(scene, vector3_create(0.0f, -2.0f, -4.5f), 0.6f, metallic_material);
+
+    // Add multiple lights for better scene illumination
+    Vector3 main_light = vector3_create(3.0f, 3.0f, 2.0f);
+    scene_add_light(scene, main_light, color_create(1.0f, 1.0f, 1.0f), 1.0f);
+    scene_add_light(scene, vector3_create(-2.0f, 1.0f, 1.0f), color_create(0.3f, 0.3f, 0.8f), 0.5f);
+
+    // Create camera
     Camera camera = camera_create(
         vector3_create(0.0f, 0.0f, 0.0f),  // position
         vector3_create(0.0f, 0.0f, -1.0f), // target
@@ -201,32 +168,146 @@ int main(int argc, char *argv[])
         45.0f                              // field of view
     );
 
-    BenchmarkResult results[4];
-    benchmark_simple_rasterization(renderer, &results[0]);
-    benchmark_basic_raytracing(renderer, scene, &results[1]);
-    benchmark_advanced_raytracing(renderer, scene, &camera, &results[2]);
-    benchmark_anti_aliased_raytracing(renderer, scene, &camera, &results[3]);
-
-    print_benchmark_results(results, 4);
+    // Render settings
+    RenderSettings settings = {
+        .enable_shadows = true,
+        .enable_reflections = true,
+        .enable_anti_aliasing = false, // Start with AA off for performance
+        .samples_per_pixel = 4,
+        .reflection_strength = 0.3f,
+        .enable_progressive = true, // With AA on, refine the image while nothing moves
+        .progressive_samples_per_frame = 1,
+        .progressive_max_samples = 64,
+        .enable_adaptive_aa = false,
+        .adaptive_min_samples = 2,
+        .adaptive_threshold = 0.05f,
+        .enable_gbuffer = true}; // Mouse-driven light moves re-shade cached primary hits
 
-    // Wait for user to close window
-    SDL_Event event;
     bool running = true;
+    SDL_Event event;
+
+    printf("Advanced Raytracing Showcase Controls:\n");
+    printf("- Mouse: Control main light position\n");
+    printf("- WASD: Move camera (W=forward, S=back, A=left, D=right)\n");
+    printf("- 1: Toggle shadows\n");
+    printf("- 2: Toggle reflections\n");
+    printf("- 3: Toggle anti-aliasing (performance impact)\n");
+    printf("- 4: Toggle progressive anti-aliasing (accumulates while the view is static)\n");
+    printf("- 5: Toggle adaptive anti-aliasing (extra samples only on edges)\n");
+    printf("- 6: Toggle wavefront tracing (stage-by-stage batches per tile)\n");
+    printf("- 7: Toggle the render stats overlay (counts need a RAYTRACING_STATS build)\n");
+    printf("- 8: Start/stop a timeline capture, written to raytracing_trace.json\n");
+    printf("- SPACE: Reset light position\n");
+    printf("- ESC: Exit\n");
+    printf("Rendering with shadows and reflections enabled on %d threads...\n",
+           thread_pool_size(context->thread_pool));
+    printf("Presenting %s with %d frame buffers\n", vsync ? "on vsync" : "at the target frame rate", buffer_count);
+
+    RenderShared shared = {
+        .input_version = 1,
+        .settings = settings,
+        .camera = camera,
+        .light_position = main_light,
+        .running = true,
+        .context = context,
+        .scene = scene,
+        .frames = frames};
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.input_changed, NULL);
+
+    pthread_t render_thread;
+    if (pthread_create(&render_thread, NULL, render_thread_main, &shared) != 0)
+    {
+        fprintf(stderr, "Failed to start the render thread\n");
+        pthread_cond_destroy(&shared.input_changed);
+        pthread_mutex_destroy(&shared.lock);
+        scene_destroy(scene);
+        render_context_destroy(context);
+        SDL_DestroyTexture(texture);
+        frame_queue_destroy(frames);
+        cleanup_graphics(window, renderer);
+        return 1;
+    }
+
+    // Time between presents, which is what the user sees; render times are
+    // reported separately by the render context
+    FrameStats present_stats;
+    frame_stats_init(&present_stats, "Present interval", 2.0);
+
+    trace_set_thread_name("main", -1);
+    double frame_period = 1.0 / target_fps;
+    double next_present = timer_seconds();
+    double last_present = next_present;
+    bool have_frame = false;
     while (running)
     {
-        while (SDL_PollEvent(&event))
+        Uint64 span = trace_span_begin();
+        handle_events(&event, &running, &main_light, &settings, &camera);
+        trace_span_end("events", span, -1);
+
+        // Hand changed input to the render thread for its next frame
+        pthread_mutex_lock(&shared.lock);
+        if (!render_settings_equal(&shared.settings, &settings) || !camera_equal(&shared.camera, &camera) ||
+            !vector3_equal(shared.light_position, main_light))
+        {
+            shared.settings = settings;
+            shared.camera = camera;
+            shared.light_position = main_light;
+            shared.input_version++;
+            pthread_cond_signal(&shared.input_changed);
+        }
+        pthread_mutex_unlock(&shared.lock);
+
+        // Upload the newest finished frame, or show the last one again
+        span = trace_span_begin();
+        Framebuffer *framebuffer = frame_queue_acquire(frames);
+        if (framebuffer)
+        {
+            framebuffer_blit(renderer, texture, framebuffer);
+            have_frame = true;
+        }
+        else if (have_frame)
         {
-            if (event.type == SDL_QUIT)
-            {
-                running = false;
-            }
+            SDL_RenderCopy(renderer, texture, NULL, NULL);
+        }
+        else
+        {
+            SDL_RenderClear(renderer);
+        }
+        SDL_RenderPresent(renderer);
+        trace_span_end("present", span, -1);
+
+        double now = timer_seconds();
+        frame_stats_add(&present_stats, now - last_present);
+        last_present = now;
+
+        // Without vsync, sleep until the next present is due; after a late
+        // frame the schedule restarts from now instead of presenting a burst
+        if (!vsync)
+        {
+            next_present += frame_period;
+            double wait = next_present - now;
+            if (wait > 0.0)
+                SDL_Delay((Uint32)(wait * 1000.0));
+            else
+                next_present = now;
         }
-        SDL_Delay(100);
     }
 
+    pthread_mutex_lock(&shared.lock);
+    shared.running = false;
+    pthread_cond_signal(&shared.input_changed);
+    pthread_mutex_unlock(&shared.lock);
+    frame_queue_close(frames);
+    pthread_join(render_thread, NULL);
+    pthread_cond_destroy(&shared.input_changed);
+    pthread_mutex_destroy(&shared.lock);
+    printf("%llu finished frames were replaced before being shown\n", frame_queue_skipped(frames));
+
     scene_destroy(scene);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
+    render_context_destroy(context);
+    SDL_DestroyTexture(texture);
+    frame_queue_destroy(frames);
+    cleanup_graphics(window, renderer);
     return 0;
-}
\ No newline at end of file
+}
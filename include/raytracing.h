@@ -1,31 +1,57 @@
 #ifndef RAYTRACING_H
 #define RAYTRACING_H
 
+// Define RAYTRACING_HEADLESS to build the core renderer without SDL
+#ifndef RAYTRACING_HEADLESS
 #include <SDL2/SDL.h>
+#else
+#include <stdint.h>
+typedef uint8_t Uint8;
+typedef uint32_t Uint32;
+typedef uint64_t Uint64;
+#endif
 #include <stdio.h>
 #include <stdbool.h>
 #include <math.h>
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 // Constants
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
-#define MAX_SPHERES 10
-#define MAX_LIGHTS 5
+#define MAX_LIGHTS 8
 #define MAX_REFLECTIONS 3
 #define EPSILON 0.001f
+#define RENDER_TILE_SIZE 32
+#define SPHERE_SIMD_WIDTH 8 // widest intersection kernel (AVX2)
+#define RAY_PACKET_SIZE 8 // primary rays traced together (8x1 pixels)
+
+// Define RAYTRACING_PAD_VECTORS to pad Vector3 and Color to 16 bytes, so
+// the SIMD math backends move them with single loads and stores
 
 // Vector3 structure for 3D coordinates
 typedef struct
 {
     float x, y, z;
+#ifdef RAYTRACING_PAD_VECTORS
+    float w; // always 0
+#endif
 } Vector3;
 
 // Color structure
 typedef struct
 {
     float r, g, b;
+#ifdef RAYTRACING_PAD_VECTORS
+    float a; // always 0
+#endif
 } Color;
 
+// Inline vector and color operations (vector3_*, color_*)
+#include "vector_math.h"
+
 // Material properties
 typedef struct
 {
@@ -41,7 +67,7 @@ typedef struct
 {
     Vector3 center;
     float radius;
-    Material material;
+    int material_id; // index into the scene's material table
 } Sphere;
 
 // Light structure
@@ -62,16 +88,80 @@ typedef struct
     float aspect_ratio;
 } Camera;
 
+// Sphere geometry as separate arrays, padded by one SIMD vector
+typedef struct
+{
+    float *center_x;
+    float *center_y;
+    float *center_z;
+    float *radius_sq; // -INFINITY in padding lanes
+    int capacity;
+} SphereSoA;
+
+// BVH node: a leaf when count > 0, otherwise its children are first and first + 1
+typedef struct
+{
+    Vector3 bounds_min;
+    Vector3 bounds_max;
+    int first;
+    int count;
+} BvhNode;
+
+// Bounding volume hierarchy with leaf spheres stored contiguously
+typedef struct
+{
+    BvhNode *nodes;
+    int node_count;
+    int *sphere_index; // BVH order -> index into scene->spheres
+    SphereSoA geometry; // spheres in BVH order
+    int sphere_count;
+} Bvh;
+
 // Scene structure
 typedef struct
 {
-    Sphere spheres[MAX_SPHERES];
+    Sphere *spheres; // grows as spheres are added
+    int sphere_capacity;
+    Material *materials; // shared by spheres through their material_id
+    int material_count;
+    int material_capacity;
+    Bvh bvh;
+    bool bvh_dirty; // spheres were added since the BVH was built
     int sphere_count;
     Light lights[MAX_LIGHTS];
     int light_count;
     Color background;
+    unsigned int version; // bumped whenever spheres or lights are added
 } Scene;
 
+// Procedural scene layouts for scaling measurements
+typedef enum
+{
+    SCENE_FIELD,       // spheres spread uniformly through a box
+    SCENE_CLUSTERS,    // dense clumps of small spheres in mostly empty space
+    SCENE_MANY_LIGHTS, // a field lit by MAX_LIGHTS lights
+    SCENE_CORRIDOR,    // mirror spheres lining a corridor the camera looks down
+    SCENE_KIND_COUNT
+} SceneKind;
+
+// Curve applied after exposure when converting HDR colors to 8 bits
+typedef enum
+{
+    TONE_CURVE_CLAMP,    // clamp to [0, 1]
+    TONE_CURVE_REINHARD, // v / (1 + v)
+    TONE_CURVE_ACES      // filmic curve, approximating ACES
+} ToneCurve;
+
+// Post-process applied to the whole frame once tracing finishes;
+// all-zero settings reproduce plain clamping
+typedef struct
+{
+    float exposure;  // in stops, 0 leaves colors unscaled
+    ToneCurve curve;
+    bool srgb;       // encode with the sRGB transfer curve
+    bool dither;     // 4x4 ordered dither before truncating to 8 bits
+} ToneMapSettings;
+
 // Render settings for advanced rendering
 typedef struct
 {
@@ -80,6 +170,19 @@ typedef struct
     bool enable_anti_aliasing;
     int samples_per_pixel;
     float reflection_strength;
+    bool enable_progressive;           // accumulate AA samples while the view is static
+    int progressive_samples_per_frame; // samples added per pixel each frame
+    int progressive_max_samples;       // stop tracing once this many are accumulated
+    bool enable_adaptive_aa;           // supersample only pixels whose first samples differ
+    int adaptive_min_samples;          // samples traced for every pixel (at least 2)
+    float adaptive_threshold;          // per-channel contrast that triggers the full sample count
+    bool enable_gbuffer;               // cache primary hits; light-only changes skip re-tracing
+    int max_depth;                     // reflection bounces per path, 0 for MAX_REFLECTIONS
+    float roulette_threshold;          // path throughput below which Russian roulette starts, 0 disables
+    bool enable_wavefront;             // trace tiles stage by stage instead of one path at a time
+    bool enable_ray_sorting;           // wavefront only: sort bounce rays by direction and origin first
+    ToneMapSettings tone_map;          // HDR to 8-bit conversion of the finished frame
+    bool show_stats;                   // draw the frame's render counters over the image
 } RenderSettings;
 
 // Ray structure
@@ -89,31 +192,235 @@ typedef struct
     Vector3 direction;
 } Ray;
 
-// Hit information
+// Coherent rays in structure-of-arrays form; lanes from count on are inactive
+typedef struct
+{
+    float origin_x[RAY_PACKET_SIZE];
+    float origin_y[RAY_PACKET_SIZE];
+    float origin_z[RAY_PACKET_SIZE];
+    float direction_x[RAY_PACKET_SIZE];
+    float direction_y[RAY_PACKET_SIZE];
+    float direction_z[RAY_PACKET_SIZE];
+    int count;
+} RayPacket;
+
+// Closest hit prepared for shading; only the final hit of a ray is resolved
+// this far, candidates are compared by distance and sphere index alone
 typedef struct
 {
     bool hit;
     float distance;
+    int primitive; // sphere index, -1 on a miss
     Vector3 point;
     Vector3 normal;
-    Material material;
+    const Material *material; // entry of the scene's material table
 } HitInfo;
 
+// CPU framebuffer of packed RGBA8888 pixels, uploaded once per frame
+typedef struct
+{
+    int width;
+    int height;
+    Uint32 *pixels;
+    Color *hdr_pixels; // optional unclamped colors, NULL unless enabled
+} Framebuffer;
+
+// Framebuffers handed from a render thread to the display thread
+typedef struct FrameQueue FrameQueue;
+#define FRAME_QUEUE_MAX_BUFFERS 3
+
+// Persistent pool of worker threads with per-thread work-stealing deques
+typedef struct ThreadPool ThreadPool;
+typedef void (*ThreadPoolTask)(void *user_data, int task_index, int thread_index);
+
+// Per-thread shadow state: the sphere that last blocked each light, tried
+// first by the next shadow ray (-1 when unknown). Padded to a cache line.
+typedef struct
+{
+    int last_occluder[MAX_LIGHTS];
+    char padding[64 - sizeof(int) * MAX_LIGHTS];
+} ShadowCache;
+_Static_assert(sizeof(ShadowCache) == 64, "ShadowCache must fill one cache line (MAX_LIGHTS at most 16)");
+
+// Ray kinds counted by the render statistics
+typedef enum
+{
+    RAY_CAMERA,
+    RAY_SHADOW,
+    RAY_REFLECTION,
+    RAY_TYPE_COUNT
+} RayType;
+
+#define RENDER_STATS_DEPTHS 8 // path depth histogram buckets; the last also holds deeper paths
+
+// Work done in one frame. Only builds with RAYTRACING_STATS count anything;
+// otherwise the counting macros below compile to nothing and these stay zero.
+typedef struct
+{
+    unsigned long long rays[RAY_TYPE_COUNT];
+    unsigned long long sphere_tests;                     // spheres handed to the intersection kernels
+    unsigned long long shadow_early_outs;                // shadow rays answered by the cached occluder
+    unsigned long long path_depths[RENDER_STATS_DEPTHS]; // shaded paths by reflection rays traced
+} RenderStats;
+
+// One thread's counters, padded to whole cache lines so workers never share one
+typedef struct
+{
+    RenderStats stats;
+    char padding[128 - sizeof(RenderStats)];
+} RenderStatsSlot;
+
+// Counting goes through a thread-local pointer that render tiles bind to
+// their thread's slot, so the shading and intersection code needs no extra
+// parameters; unbound threads count into a scratch block that is never read
+#ifdef RAYTRACING_STATS
+extern __thread RenderStats *render_stats_thread;
+#define RENDER_STATS_ADD(field, amount) (render_stats_thread->field += (unsigned long long)(amount))
+#define RENDER_STATS_DEPTH(depth) \
+    (render_stats_thread->path_depths[(depth) < RENDER_STATS_DEPTHS ? (depth) : RENDER_STATS_DEPTHS - 1]++)
+#define RENDER_STATS_BIND(stats) render_stats_bind(stats)
+#else
+#define RENDER_STATS_ADD(field, amount) ((void)0)
+#define RENDER_STATS_DEPTH(depth) ((void)0)
+#define RENDER_STATS_BIND(stats) ((void)0)
+#endif
+
+// Hardware events counted by perf_counters_* (Linux perf_event_open)
+typedef enum
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES, // L1 data cache read misses
+    PERF_LLC_MISSES, // last level cache read misses
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+} PerfCounterKind;
+
+// The open events form one group, scheduled onto the hardware together so
+// ratios such as instructions per cycle compare the same time slices
+typedef struct
+{
+    int fds[PERF_COUNTER_COUNT]; // -1 where the event is unavailable
+    int group;                   // fd of the group leader, -1 when nothing is open
+    int member_count;
+    PerfCounterKind members[PERF_COUNTER_COUNT]; // group read order
+    Uint64 start_enabled;        // group times at perf_counters_start
+    Uint64 start_running;
+} PerfCounters;
+
+typedef struct
+{
+    double values[PERF_COUNTER_COUNT];
+    bool valid[PERF_COUNTER_COUNT];
+} PerfReading;
+
+// What follows a hit along a path
+typedef enum
+{
+    PATH_STOP,       // no further bounce
+    PATH_BACKGROUND, // the last allowed bounce, which sees only the background
+    PATH_REFLECT     // trace the reflection ray
+} PathStep;
+
+// Shading kernel specialized at compile time for one combination of the
+// shadow and reflection settings
+typedef Color (*ShadeKernel)(Ray ray, HitInfo *hit, Scene *scene, RenderSettings *settings, Uint32 path_seed,
+                             ShadowCache *shadow_cache);
+
+// Ray queues and per-pixel sums reused by one thread's wavefront batches
+typedef struct WavefrontQueues WavefrontQueues;
+
+// Camera samples of a pixel rectangle traced as one wavefront batch
+typedef struct
+{
+    Camera *camera;
+    int width; // framebuffer size, for the camera u/v
+    int height;
+    int x0, y0, x1, y1;
+    Uint32 seed;      // seeds jitter and path decisions like the recursive path
+    int first_sample; // samples [first_sample, first_sample + sample_count)
+    int sample_count;
+    bool jitter;      // false traces one ray through each pixel corner
+} WavefrontBatch;
+
+// Primary hit of one pixel, cached while the camera and geometry stay put
+typedef struct
+{
+    Vector3 point;
+    Vector3 normal;
+    float distance;
+    int primitive; // index of the sphere hit, -1 for background
+} GBufferSample;
+
+// Inputs of the previous frame, used to detect what changed
+typedef struct
+{
+    bool valid;
+    const Scene *scene;
+    unsigned int scene_version;
+    int width;
+    int height;
+    Camera camera;
+    RenderSettings settings;
+    Light lights[MAX_LIGHTS];
+    int light_count;
+    Color background;
+} RenderSnapshot;
+
+#define FRAME_STATS_WINDOW 256 // frame times kept for the rolling percentiles
+
+// Rolling frame-time statistics: a ring of the most recent frame times,
+// summarized every report_interval seconds
+typedef struct
+{
+    double times[FRAME_STATS_WINDOW]; // seconds
+    int count;                        // filled entries, at most FRAME_STATS_WINDOW
+    int next;                         // ring slot the next frame goes into
+    unsigned long long total_frames;
+    double report_interval; // seconds between reports; 0 disables them
+    double last_report;     // timer_seconds() of the last report
+    const char *label;      // names the measured time in reports
+} FrameStats;
+
+typedef struct
+{
+    int frames; // frames the figures cover
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+    double jitter; // mean change between consecutive frame times
+} FrameStatsSummary;
+
+// Renderer state that lives across frames
+typedef struct
+{
+    ThreadPool *thread_pool;
+    int tile_size;
+    Uint32 frame_index; // seeds per-pixel sample jitter
+
+    // Progressive accumulation (running sum of samples per pixel)
+    Color *accumulation;
+    int accumulation_size;
+    int accumulated_samples;
+    RenderSnapshot last_frame;
+
+    // Per-pixel primary hits (only used without anti-aliasing)
+    GBufferSample *gbuffer;
+    int gbuffer_size;
+    bool gbuffer_valid;
+
+    ShadowCache *shadow_caches; // one per pool thread
+    WavefrontQueues **wavefront_queues; // one per pool thread, created on first use
+    RenderStatsSlot *thread_stats;      // one per pool thread, merged into stats after each frame
+    RenderStats stats;                  // counters of the last frame (RAYTRACING_STATS builds)
+
+    unsigned long long samples_traced; // camera samples traced in the last frame
+    FrameStats frame_stats;            // render time per frame; set report_interval to print them
+} RenderContext;
+
 // Function declarations
-Vector3 vector3_create(float x, float y, float z);
-Vector3 vector3_add(Vector3 a, Vector3 b);
-Vector3 vector3_sub(Vector3 a, Vector3 b);
-Vector3 vector3_scale(Vector3 v, float s);
-float vector3_dot(Vector3 a, Vector3 b);
-Vector3 vector3_normalize(Vector3 v);
-float vector3_length(Vector3 v);
-Vector3 vector3_cross(Vector3 a, Vector3 b);
-Vector3 vector3_reflect(Vector3 incident, Vector3 normal);
-
-Color color_create(float r, float g, float b);
-Color color_add(Color a, Color b);
-Color color_scale(Color c, float s);
-Color color_multiply(Color a, Color b);
 
 // Lighting calculations
 Color calculate_lighting(Vector3 point, Vector3 normal, Vector3 view_dir,
@@ -121,33 +428,165 @@ Color calculate_lighting(Vector3 point, Vector3 normal, Vector3 view_dir,
 Uint8 lighting_to_grayscale(Color color);
 
 // Sphere operations
-bool sphere_intersect(Sphere sphere, Ray ray, HitInfo *hit_info);
-void draw_sphere_simple(SDL_Renderer *renderer, int center_x, int center_y,
+bool sphere_intersect(const Sphere *sphere, Ray ray, float *distance);
+void draw_sphere_simple(Framebuffer *framebuffer, int center_x, int center_y,
                         int radius, Vector3 light_pos);
 
+// SIMD intersection over SphereSoA (kernel picked at runtime from CPU features)
+void intersect_init(void);
+const char *intersect_kernel_name(void);
+bool sphere_soa_init(SphereSoA *soa, int count);
+void sphere_soa_free(SphereSoA *soa);
+void sphere_soa_set(SphereSoA *soa, int index, Vector3 center, float radius);
+int sphere_soa_nearest(const SphereSoA *soa, int first, int count, Ray ray, float *distance);
+int sphere_soa_occluder(const SphereSoA *soa, int first, int count, Ray ray, float max_distance);
+void ray_packet_clear(RayPacket *packet);
+void ray_packet_set(RayPacket *packet, int lane, Ray ray);
+void ray_packet_nearest(const SphereSoA *soa, int first, int count, const RayPacket *packet,
+                        float *distance, int *index);
+
+// Bounding volume hierarchy (binned SAH build)
+bool bvh_build(Bvh *bvh, const Sphere *spheres, int sphere_count);
+void bvh_free(Bvh *bvh);
+int bvh_closest_hit(const Bvh *bvh, Ray ray, float *distance);
+bool bvh_occluded(const Bvh *bvh, Ray ray, float max_distance, int *last_occluder);
+void bvh_closest_hit_packet(const Bvh *bvh, const RayPacket *packet, float *distance, int *index);
+
 // Scene management
 Scene *scene_create(void);
 void scene_destroy(Scene *scene);
+int scene_add_material(Scene *scene, Material material);
 void scene_add_sphere(Scene *scene, Vector3 center, float radius, Material material);
+void scene_add_sphere_with_material(Scene *scene, Vector3 center, float radius, int material_id);
 void scene_add_light(Scene *scene, Vector3 position, Color color, float intensity);
+Scene *scene_load(const char *path, Camera *camera);
+bool scene_update_bvh(Scene *scene);
+Scene *scene_generate(SceneKind kind, int sphere_count, int light_count, Uint32 seed, Camera *camera);
+const char *scene_kind_name(SceneKind kind);
+bool scene_kind_parse(const char *name, SceneKind *kind);
+
+// Framebuffer management
+Framebuffer *framebuffer_create(int width, int height);
+void framebuffer_destroy(Framebuffer *framebuffer);
+Uint32 framebuffer_pack_rgb(Uint8 r, Uint8 g, Uint8 b);
+Uint32 framebuffer_pack_color(Color color);
+void framebuffer_clear(Framebuffer *framebuffer, Uint8 r, Uint8 g, Uint8 b);
+void framebuffer_set_pixel(Framebuffer *framebuffer, int x, int y, Color color);
+bool framebuffer_enable_hdr(Framebuffer *framebuffer);
+Uint8 framebuffer_quantize(float value);
+void framebuffer_tonemap(Framebuffer *framebuffer, const ToneMapSettings *settings, int first_row, int row_count);
+
+// Frame queue: two buffers make the renderer wait for the display to take
+// each frame; three let it run ahead, replacing frames the display skipped
+FrameQueue *frame_queue_create(int width, int height, int buffer_count);
+void frame_queue_destroy(FrameQueue *queue);
+Framebuffer *frame_queue_begin_write(FrameQueue *queue);
+void frame_queue_end_write(FrameQueue *queue, Framebuffer *framebuffer);
+Framebuffer *frame_queue_acquire(FrameQueue *queue);
+void frame_queue_close(FrameQueue *queue);
+unsigned long long frame_queue_skipped(FrameQueue *queue);
+
+// Image output (format chosen from the file extension: .ppm, .pfm or .png)
+int image_write(const char *path, Framebuffer *framebuffer);
+int image_write_ppm(const char *path, Framebuffer *framebuffer);
+int image_write_pfm(const char *path, Framebuffer *framebuffer);
+int image_write_png(const char *path, Framebuffer *framebuffer);
+
+// Thread pool (thread_count <= 0 means one thread per CPU)
+ThreadPool *thread_pool_create(int thread_count);
+void thread_pool_destroy(ThreadPool *pool);
+int thread_pool_size(ThreadPool *pool);
+int thread_pool_default_thread_count(void);
+void thread_pool_run(ThreadPool *pool, int task_count, ThreadPoolTask task, void *user_data);
+
+// Render context (thread_count 1 renders on the calling thread only)
+RenderContext *render_context_create(int thread_count);
+void render_context_destroy(RenderContext *context);
+bool render_context_refining(const RenderContext *context, const RenderSettings *settings);
+bool render_settings_equal(const RenderSettings *a, const RenderSettings *b);
+
+// Counter-based random numbers
+Uint32 random_hash(Uint32 value);
+Uint32 random_hash4(Uint32 a, Uint32 b, Uint32 c, Uint32 d);
+float random_float(Uint32 frame, Uint32 pixel, Uint32 sample, Uint32 dimension);
+Uint32 random_path_seed(Uint32 seed, Uint32 pixel, int sample);
 
 // Camera functions
 Camera camera_create(Vector3 position, Vector3 target, Vector3 up, float fov);
 Ray camera_get_ray(Camera camera, float u, float v);
+bool camera_equal(const Camera *a, const Camera *b);
 
 // Rendering
-void render_scene(SDL_Renderer *renderer, Scene *scene, Vector3 camera_pos);
-void render_scene_advanced(SDL_Renderer *renderer, Scene *scene, Camera *camera, RenderSettings *settings);
-Ray create_camera_ray(int x, int y, Vector3 camera_pos);
-Color trace_ray(Ray ray, Scene *scene, RenderSettings *settings, int depth);
-bool is_in_shadow(Vector3 point, Vector3 light_pos, Scene *scene);
+void render_scene(Framebuffer *framebuffer, Scene *scene, Vector3 camera_pos);
+void render_scene_advanced(RenderContext *context, Framebuffer *framebuffer, Scene *scene,
+                           Camera *camera, RenderSettings *settings);
+Ray create_camera_ray(int x, int y, int width, int height, Vector3 camera_pos);
+Color trace_ray(Ray ray, Scene *scene, RenderSettings *settings, Uint32 path_seed, ShadowCache *shadow_cache);
+int scene_closest_hit(Scene *scene, Ray ray, HitInfo *closest_hit);
+void scene_resolve_hit(Scene *scene, Ray ray, int index, float distance, HitInfo *hit);
+void scene_closest_hit_packet(Scene *scene, const RayPacket *packet, float *distance, int *index);
+Color shade_hit(Ray ray, HitInfo *hit, Scene *scene, RenderSettings *settings, Uint32 path_seed,
+                ShadowCache *shadow_cache);
+ShadeKernel shade_kernel_select(const RenderSettings *settings);
+void shadow_cache_reset(ShadowCache *cache);
+bool is_in_shadow(Vector3 point, Vector3 light_pos, Scene *scene, int *last_occluder);
+Ray shadow_ray_create(Vector3 point, Vector3 light_pos, float *light_distance);
+bool scene_occluded(Scene *scene, Ray ray, float max_distance, int *last_occluder);
+bool light_contribution(const HitInfo *hit, const Light *light, Vector3 view_dir, Color *contribution);
+PathStep path_next_bounce(const Material *material, RenderSettings *settings, int depth,
+                          Uint32 path_seed, float *throughput);
+Ray reflect_ray_create(Ray ray, const HitInfo *hit);
+
+// Wavefront rendering (ray generation, intersection, shading and shadow stages)
+WavefrontQueues *wavefront_create(void);
+void wavefront_destroy(WavefrontQueues *queues);
+Color *wavefront_trace(WavefrontQueues *queues, const WavefrontBatch *batch, Scene *scene,
+                       RenderSettings *settings, ShadowCache *shadow_cache);
 
 // Performance monitoring
-void print_performance_stats(int frame_count, float total_time);
+double timer_seconds(void);
+void frame_stats_init(FrameStats *stats, const char *label, double report_interval);
+void frame_stats_reset(FrameStats *stats);
+void frame_stats_add(FrameStats *stats, double seconds);
+bool frame_stats_summarize(const FrameStats *stats, FrameStatsSummary *summary);
+void frame_stats_print(const FrameStats *stats, FILE *stream);
+RenderStatsSlot *render_stats_create_slots(int count);
+void render_stats_bind(RenderStats *stats);
+void render_stats_merge(RenderStats *total, RenderStatsSlot *slots, int count);
+void render_stats_print(const RenderStats *stats, FILE *stream);
+void render_stats_draw(Framebuffer *framebuffer, const RenderStats *stats);
+
+// Hardware counters for the calling process and threads it creates later
+int perf_counters_open(PerfCounters *counters);
+void perf_counters_close(PerfCounters *counters);
+void perf_counters_start(PerfCounters *counters);
+void perf_counters_stop(PerfCounters *counters, PerfReading *reading);
+const char *perf_counter_name(PerfCounterKind kind);
+
+// Timeline tracing, written as Chrome trace JSON. Wrap a stage in
+// trace_span_begin / trace_span_end; spans only record during a capture.
+void trace_start(void);
+void trace_stop(void);
+bool trace_active(void);
+Uint64 trace_span_begin(void);
+void trace_span_end(const char *name, Uint64 start, int arg);
+void trace_set_thread_name(const char *name, int index);
+int trace_write(const char *path);
+
+// Text overlay drawn straight into the framebuffer (5x7 font, scaled 2x)
+#define OVERLAY_CHAR_WIDTH 12
+#define OVERLAY_LINE_HEIGHT 18
+void overlay_draw_panel(Framebuffer *framebuffer, int x, int y, int width, int height);
+void overlay_draw_text(Framebuffer *framebuffer, int x, int y, const char *text, Uint32 color);
 
+#ifndef RAYTRACING_HEADLESS
 // Application management
 int init_graphics(SDL_Window **window, SDL_Renderer **renderer);
 void cleanup_graphics(SDL_Window *window, SDL_Renderer *renderer);
+SDL_Texture *framebuffer_create_texture(SDL_Renderer *renderer, Framebuffer *framebuffer);
+void framebuffer_blit(SDL_Renderer *renderer, SDL_Texture *texture, Framebuffer *framebuffer);
+int parse_thread_count(int argc, char *argv[]);
 void handle_events(SDL_Event *event, bool *running, Vector3 *light_pos, RenderSettings *settings, Camera *camera);
+#endif
 
 #endif // RAYTRACING_H
\ No newline at end of file
@@ -0,0 +1,291 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+// Header-inline Vector3 and Color math, included by raytracing.h after the
+// two types are declared so every translation unit inlines it.
+//
+// Backends are picked at compile time. Define one of RAYTRACING_MATH_SCALAR,
+// RAYTRACING_MATH_SSE41 or RAYTRACING_MATH_AVX2, or leave all undefined to
+// use the widest one the compiler targets (-msse4.1, -mavx2 -mfma). The
+// scalar and SSE4.1 backends give bit-identical results; AVX2 fuses
+// multiply-adds, which rounds once instead of twice.
+//
+// Define RAYTRACING_FAST_NORMALIZE to normalize with the hardware reciprocal
+// square root plus one Newton-Raphson step (about 22 bits) instead of a
+// square root and a divide. It only needs SSE, so it applies to every
+// backend, the scalar one included, on x86 targets.
+
+#if !defined(RAYTRACING_MATH_SCALAR) && !defined(RAYTRACING_MATH_SSE41) && !defined(RAYTRACING_MATH_AVX2)
+#if defined(__AVX2__) && defined(__FMA__)
+#define RAYTRACING_MATH_AVX2
+#elif defined(__SSE4_1__)
+#define RAYTRACING_MATH_SSE41
+#else
+#define RAYTRACING_MATH_SCALAR
+#endif
+#endif
+
+#if defined(RAYTRACING_MATH_AVX2)
+#if !defined(__AVX2__) || !defined(__FMA__)
+#error "RAYTRACING_MATH_AVX2 needs -mavx2 -mfma"
+#endif
+#define VECTOR_MATH_SIMD 1
+#define VECTOR_MATH_FMA 1
+#define VECTOR_MATH_BACKEND "avx2"
+#elif defined(RAYTRACING_MATH_SSE41)
+#if !defined(__SSE4_1__)
+#error "RAYTRACING_MATH_SSE41 needs -msse4.1"
+#endif
+#define VECTOR_MATH_SIMD 1
+#define VECTOR_MATH_BACKEND "sse4.1"
+#else
+#define VECTOR_MATH_BACKEND "scalar"
+#endif
+
+#ifdef RAYTRACING_FAST_NORMALIZE
+#ifndef __SSE__
+#error "RAYTRACING_FAST_NORMALIZE needs an x86 target with SSE"
+#endif
+#include <xmmintrin.h>
+#endif
+
+// Trailing initializer for the padding lane, when there is one
+#ifdef RAYTRACING_PAD_VECTORS
+#define VECTOR_MATH_PAD , 0.0f
+#else
+#define VECTOR_MATH_PAD
+#endif
+
+#ifdef VECTOR_MATH_SIMD
+#include <immintrin.h>
+
+// Lanes x, y, z and a zero; padded types load and store in one instruction
+#ifdef RAYTRACING_PAD_VECTORS
+#define VECTOR_MATH_LOAD(v) _mm_loadu_ps(&(v).x)
+#define COLOR_MATH_LOAD(c) _mm_loadu_ps(&(c).r)
+#else
+#define VECTOR_MATH_LOAD(v) _mm_set_ps(0.0f, (v).z, (v).y, (v).x)
+#define COLOR_MATH_LOAD(c) _mm_set_ps(0.0f, (c).b, (c).g, (c).r)
+#endif
+
+#ifdef RAYTRACING_PAD_VECTORS
+static inline Vector3 vector3_from_m128(__m128 m)
+{
+    Vector3 v;
+    _mm_storeu_ps(&v.x, m);
+    return v;
+}
+
+static inline Color color_from_m128(__m128 m)
+{
+    Color c;
+    _mm_storeu_ps(&c.r, m);
+    return c;
+}
+#else
+static inline Vector3 vector3_from_m128(__m128 m)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, m);
+    Vector3 v = {lanes[0], lanes[1], lanes[2]};
+    return v;
+}
+
+static inline Color color_from_m128(__m128 m)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, m);
+    Color c = {lanes[0], lanes[1], lanes[2]};
+    return c;
+}
+#endif
+#endif
+
+// Vector3 operations
+static inline Vector3 vector3_create(float x, float y, float z)
+{
+    Vector3 v = {x, y, z VECTOR_MATH_PAD};
+    return v;
+}
+
+#ifdef VECTOR_MATH_SIMD
+
+static inline Vector3 vector3_add(Vector3 a, Vector3 b)
+{
+    return vector3_from_m128(_mm_add_ps(VECTOR_MATH_LOAD(a), VECTOR_MATH_LOAD(b)));
+}
+
+static inline Vector3 vector3_sub(Vector3 a, Vector3 b)
+{
+    return vector3_from_m128(_mm_sub_ps(VECTOR_MATH_LOAD(a), VECTOR_MATH_LOAD(b)));
+}
+
+static inline Vector3 vector3_scale(Vector3 v, float s)
+{
+    return vector3_from_m128(_mm_mul_ps(VECTOR_MATH_LOAD(v), _mm_set1_ps(s)));
+}
+
+// a + b * s
+static inline Vector3 vector3_add_scaled(Vector3 a, Vector3 b, float s)
+{
+#ifdef VECTOR_MATH_FMA
+    return vector3_from_m128(_mm_fmadd_ps(VECTOR_MATH_LOAD(b), _mm_set1_ps(s), VECTOR_MATH_LOAD(a)));
+#else
+    return vector3_from_m128(_mm_add_ps(VECTOR_MATH_LOAD(a), _mm_mul_ps(VECTOR_MATH_LOAD(b), _mm_set1_ps(s))));
+#endif
+}
+
+// dpps sums (x + y) + (z + 0), the same order as the scalar backend;
+// with FMA the products are accumulated unrounded instead
+static inline float vector3_dot(Vector3 a, Vector3 b)
+{
+#ifdef VECTOR_MATH_FMA
+    return fmaf(a.z, b.z, fmaf(a.y, b.y, a.x * b.x));
+#else
+    return _mm_cvtss_f32(_mm_dp_ps(VECTOR_MATH_LOAD(a), VECTOR_MATH_LOAD(b), 0x71));
+#endif
+}
+
+static inline Vector3 vector3_cross(Vector3 a, Vector3 b)
+{
+    __m128 va = VECTOR_MATH_LOAD(a);
+    __m128 vb = VECTOR_MATH_LOAD(b);
+    __m128 a_yzx = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 a_zxy = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 b_zxy = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 1, 0, 2));
+    return vector3_from_m128(_mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx)));
+}
+
+#else
+
+static inline Vector3 vector3_add(Vector3 a, Vector3 b)
+{
+    return vector3_create(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+static inline Vector3 vector3_sub(Vector3 a, Vector3 b)
+{
+    return vector3_create(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline Vector3 vector3_scale(Vector3 v, float s)
+{
+    return vector3_create(v.x * s, v.y * s, v.z * s);
+}
+
+// a + b * s
+static inline Vector3 vector3_add_scaled(Vector3 a, Vector3 b, float s)
+{
+    return vector3_create(a.x + b.x * s, a.y + b.y * s, a.z + b.z * s);
+}
+
+static inline float vector3_dot(Vector3 a, Vector3 b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline Vector3 vector3_cross(Vector3 a, Vector3 b)
+{
+    return vector3_create(
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x);
+}
+
+#endif
+
+static inline Vector3 vector3_reflect(Vector3 incident, Vector3 normal)
+{
+    return vector3_add_scaled(incident, normal, -2.0f * vector3_dot(incident, normal));
+}
+
+// Exact comparison of x, y and z; the padding lane is ignored
+static inline bool vector3_equal(Vector3 a, Vector3 b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static inline float vector3_length(Vector3 v)
+{
+    return sqrtf(vector3_dot(v, v));
+}
+
+static inline Vector3 vector3_normalize(Vector3 v)
+{
+    float length_sq = vector3_dot(v, v);
+    if (length_sq > 0.0f)
+    {
+#ifdef RAYTRACING_FAST_NORMALIZE
+        __m128 l = _mm_set_ss(length_sq);
+        __m128 r = _mm_rsqrt_ss(l);
+        // r * (1.5 - 0.5 * l * r * r)
+        r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), l), _mm_mul_ss(r, r))));
+        return vector3_scale(v, _mm_cvtss_f32(r));
+#else
+        return vector3_scale(v, 1.0f / sqrtf(length_sq));
+#endif
+    }
+    return vector3_create(0, 0, 0);
+}
+
+// Color operations
+static inline Color color_create(float r, float g, float b)
+{
+    Color c = {r, g, b VECTOR_MATH_PAD};
+    return c;
+}
+
+#ifdef VECTOR_MATH_SIMD
+
+static inline Color color_add(Color a, Color b)
+{
+    return color_from_m128(_mm_add_ps(COLOR_MATH_LOAD(a), COLOR_MATH_LOAD(b)));
+}
+
+static inline Color color_scale(Color c, float s)
+{
+    return color_from_m128(_mm_mul_ps(COLOR_MATH_LOAD(c), _mm_set1_ps(s)));
+}
+
+static inline Color color_multiply(Color a, Color b)
+{
+    return color_from_m128(_mm_mul_ps(COLOR_MATH_LOAD(a), COLOR_MATH_LOAD(b)));
+}
+
+// a + b * s
+static inline Color color_add_scaled(Color a, Color b, float s)
+{
+#ifdef VECTOR_MATH_FMA
+    return color_from_m128(_mm_fmadd_ps(COLOR_MATH_LOAD(b), _mm_set1_ps(s), COLOR_MATH_LOAD(a)));
+#else
+    return color_from_m128(_mm_add_ps(COLOR_MATH_LOAD(a), _mm_mul_ps(COLOR_MATH_LOAD(b), _mm_set1_ps(s))));
+#endif
+}
+
+#else
+
+static inline Color color_add(Color a, Color b)
+{
+    return color_create(a.r + b.r, a.g + b.g, a.b + b.b);
+}
+
+static inline Color color_scale(Color c, float s)
+{
+    return color_create(c.r * s, c.g * s, c.b * s);
+}
+
+static inline Color color_multiply(Color a, Color b)
+{
+    return color_create(a.r * b.r, a.g * b.g, a.b * b.b);
+}
+
+// a + b * s
+static inline Color color_add_scaled(Color a, Color b, float s)
+{
+    return color_create(a.r + b.r * s, a.g + b.g * s, a.b + b.b * s);
+}
+
+#endif
+
+#endif
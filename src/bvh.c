@@ -0,0 +1,472 @@
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bounding volume hierarchy over the scene's spheres. Nodes are split with a
+// binned surface area heuristic; leaves hold a contiguous run of spheres in
+// the BVH's own SoA copy so the SIMD kernels can test a whole leaf at once.
+
+#define BVH_BIN_COUNT 16
+#define BVH_MAX_LEAF_SIZE (2 * SPHERE_SIMD_WIDTH)
+#define BVH_MAX_DEPTH 48
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH + 2)
+#define BVH_TRAVERSAL_COST 4.0f // visiting an inner node: two box tests and stack work
+#define BVH_INTERSECT_COST 2.0f // one SIMD group of sphere tests
+
+typedef struct
+{
+    Vector3 min;
+    Vector3 max;
+} Bounds;
+
+typedef struct
+{
+    const Sphere *spheres;
+    int *order;         // sphere indices, partitioned in place while building
+    Vector3 *centroids; // indexed like spheres
+    Bounds *bounds;     // indexed like spheres
+    BvhNode *nodes;
+    int node_count;
+} BvhBuilder;
+
+static Bounds bounds_empty(void)
+{
+    Bounds b;
+    b.min = vector3_create(INFINITY, INFINITY, INFINITY);
+    b.max = vector3_create(-INFINITY, -INFINITY, -INFINITY);
+    return b;
+}
+
+static void bounds_grow(Bounds *b, Vector3 min, Vector3 max)
+{
+    b->min = vector3_create(fminf(b->min.x, min.x), fminf(b->min.y, min.y), fminf(b->min.z, min.z));
+    b->max = vector3_create(fmaxf(b->max.x, max.x), fmaxf(b->max.y, max.y), fmaxf(b->max.z, max.z));
+}
+
+static float bounds_area(Bounds b)
+{
+    Vector3 d = vector3_sub(b.max, b.min);
+    if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f)
+        return 0.0f;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static float vector3_axis(Vector3 v, int axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Leaves are tested a SIMD vector at a time, so cost them per group of spheres
+static float leaf_cost(int count)
+{
+    return BVH_INTERSECT_COST * (float)((count + SPHERE_SIMD_WIDTH - 1) / SPHERE_SIMD_WIDTH);
+}
+
+static int centroid_bin(float centroid, float min, float scale)
+{
+    int bin = (int)((centroid - min) * scale);
+    if (bin < 0)
+        bin = 0;
+    if (bin >= BVH_BIN_COUNT)
+        bin = BVH_BIN_COUNT - 1;
+    return bin;
+}
+
+// Split when the best binned SAH cost beats testing every sphere in one leaf
+static void build_node(BvhBuilder *builder, int node_index, int first, int count, int depth)
+{
+    BvhNode *node = &builder->nodes[node_index];
+    Bounds node_bounds = bounds_empty();
+    Bounds centroid_bounds = bounds_empty();
+
+    for (int i = first; i < first + count; i++)
+    {
+        int sphere = builder->order[i];
+        bounds_grow(&node_bounds, builder->bounds[sphere].min, builder->bounds[sphere].max);
+        bounds_grow(&centroid_bounds, builder->centroids[sphere], builder->centroids[sphere]);
+    }
+
+    node->bounds_min = node_bounds.min;
+    node->bounds_max = node_bounds.max;
+    node->first = first;
+    node->count = count;
+
+    if (count <= 1 || depth >= BVH_MAX_DEPTH)
+        return;
+
+    float best_cost = INFINITY;
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float min = vector3_axis(centroid_bounds.min, axis);
+        float extent = vector3_axis(centroid_bounds.max, axis) - min;
+        if (extent <= 0.0f)
+            continue;
+
+        float scale = BVH_BIN_COUNT / extent;
+        Bounds bins[BVH_BIN_COUNT];
+        int bin_counts[BVH_BIN_COUNT] = {0};
+        for (int b = 0; b < BVH_BIN_COUNT; b++)
+            bins[b] = bounds_empty();
+
+        for (int i = first; i < first + count; i++)
+        {
+            int sphere = builder->order[i];
+            int b = centroid_bin(vector3_axis(builder->centroids[sphere], axis), min, scale);
+            bin_counts[b]++;
+            bounds_grow(&bins[b], builder->bounds[sphere].min, builder->bounds[sphere].max);
+        }
+
+        // Sweep from the right to get the cost of everything past each split plane
+        float right_area[BVH_BIN_COUNT];
+        int right_count[BVH_BIN_COUNT];
+        Bounds right = bounds_empty();
+        int right_total = 0;
+        for (int b = BVH_BIN_COUNT - 1; b > 0; b--)
+        {
+            bounds_grow(&right, bins[b].min, bins[b].max);
+            right_total += bin_counts[b];
+            right_area[b] = bounds_area(right);
+            right_count[b] = right_total;
+        }
+
+        Bounds left = bounds_empty();
+        int left_total = 0;
+        for (int b = 0; b < BVH_BIN_COUNT - 1; b++)
+        {
+            bounds_grow(&left, bins[b].min, bins[b].max);
+            left_total += bin_counts[b];
+            if (left_total == 0 || right_count[b + 1] == 0)
+                continue;
+
+            float cost = bounds_area(left) * leaf_cost(left_total) + right_area[b + 1] * leaf_cost(right_count[b + 1]);
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b + 1;
+            }
+        }
+    }
+
+    float node_area = bounds_area(node_bounds);
+    float split_cost = node_area > 0.0f ? BVH_TRAVERSAL_COST + best_cost / node_area : INFINITY;
+
+    if (best_axis < 0 || (count <= BVH_MAX_LEAF_SIZE && leaf_cost(count) <= split_cost))
+        return; // coincident centroids or a leaf is cheaper
+
+    // Partition the sphere order around the chosen plane
+    float min = vector3_axis(centroid_bounds.min, best_axis);
+    float scale = BVH_BIN_COUNT / (vector3_axis(centroid_bounds.max, best_axis) - min);
+    int i = first;
+    int j = first + count - 1;
+    while (i <= j)
+    {
+        int sphere = builder->order[i];
+        if (centroid_bin(vector3_axis(builder->centroids[sphere], best_axis), min, scale) < best_split)
+        {
+            i++;
+        }
+        else
+        {
+            builder->order[i] = builder->order[j];
+            builder->order[j] = sphere;
+            j--;
+        }
+    }
+
+    int left_count = i - first;
+    int left_index = builder->node_count;
+    builder->node_count += 2;
+
+    node->first = left_index; // children are stored next to each other
+    node->count = 0;
+    build_node(builder, left_index, first, left_count, depth + 1);
+    build_node(builder, left_index + 1, i, count - left_count, depth + 1);
+}
+
+bool bvh_build(Bvh *bvh, const Sphere *spheres, int sphere_count)
+{
+    bvh_free(bvh);
+    if (sphere_count == 0)
+        return true;
+
+    BvhBuilder builder;
+    builder.spheres = spheres;
+    builder.order = (int *)malloc(sizeof(int) * (size_t)sphere_count);
+    builder.centroids = (Vector3 *)malloc(sizeof(Vector3) * (size_t)sphere_count);
+    builder.bounds = (Bounds *)malloc(sizeof(Bounds) * (size_t)sphere_count);
+    builder.nodes = (BvhNode *)malloc(sizeof(BvhNode) * (size_t)(2 * sphere_count - 1));
+    builder.node_count = 1;
+
+    bool ok = builder.order && builder.centroids && builder.bounds && builder.nodes &&
+              sphere_soa_init(&bvh->geometry, sphere_count);
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to allocate BVH for %d spheres\n", sphere_count);
+        free(builder.order);
+        free(builder.centroids);
+        free(builder.bounds);
+        free(builder.nodes);
+        return false;
+    }
+
+    for (int i = 0; i < sphere_count; i++)
+    {
+        // Pad the boxes slightly so grazing hits are never culled by rounding
+        float r = spheres[i].radius + EPSILON;
+        Vector3 extent = vector3_create(r, r, r);
+        builder.order[i] = i;
+        builder.centroids[i] = spheres[i].center;
+        builder.bounds[i].min = vector3_sub(spheres[i].center, extent);
+        builder.bounds[i].max = vector3_add(spheres[i].center, extent);
+    }
+
+    build_node(&builder, 0, 0, sphere_count, 0);
+
+    // Leaves now reference runs of builder.order; lay the geometry out in that order
+    for (int i = 0; i < sphere_count; i++)
+    {
+        const Sphere *sphere = &spheres[builder.order[i]];
+        sphere_soa_set(&bvh->geometry, i, sphere->center, sphere->radius);
+    }
+
+    bvh->nodes = builder.nodes;
+    bvh->node_count = builder.node_count;
+    bvh->sphere_index = builder.order;
+    bvh->sphere_count = sphere_count;
+
+    free(builder.centroids);
+    free(builder.bounds);
+    return true;
+}
+
+void bvh_free(Bvh *bvh)
+{
+    free(bvh->nodes);
+    free(bvh->sphere_index);
+    sphere_soa_free(&bvh->geometry);
+    bvh->nodes = NULL;
+    bvh->node_count = 0;
+    bvh->sphere_index = NULL;
+    bvh->sphere_count = 0;
+}
+
+// Plain compares compile to minss/maxss; fminf/fmaxf become libm calls
+// without -ffast-math. A NaN slab (origin on the plane, zero direction)
+// leaves the other operand, which keeps the box test conservative.
+static inline float min_float(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static inline float max_float(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+// Slab test; returns the entry distance, or INFINITY when the box is missed
+// or lies entirely beyond max_distance
+static inline float node_entry(const BvhNode *node, Vector3 origin, Vector3 inv_dir, float max_distance)
+{
+    float tx1 = (node->bounds_min.x - origin.x) * inv_dir.x;
+    float tx2 = (node->bounds_max.x - origin.x) * inv_dir.x;
+    float ty1 = (node->bounds_min.y - origin.y) * inv_dir.y;
+    float ty2 = (node->bounds_max.y - origin.y) * inv_dir.y;
+    float tz1 = (node->bounds_min.z - origin.z) * inv_dir.z;
+    float tz2 = (node->bounds_max.z - origin.z) * inv_dir.z;
+
+    float t_enter = max_float(max_float(min_float(tx1, tx2), min_float(ty1, ty2)),
+                              max_float(min_float(tz1, tz2), 0.0f));
+    float t_exit = min_float(min_float(max_float(tx1, tx2), max_float(ty1, ty2)),
+                             min_float(max_float(tz1, tz2), max_distance));
+
+    return t_enter <= t_exit ? t_enter : INFINITY;
+}
+
+static Vector3 inverse_direction(Vector3 d)
+{
+    return vector3_create(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+}
+
+// Nearest sphere along the ray, visiting the closer child first; returns the
+// scene sphere index or -1
+int bvh_closest_hit(const Bvh *bvh, Ray ray, float *distance)
+{
+    float best_t = INFINITY;
+    int best = -1;
+
+    if (bvh->node_count == 0)
+    {
+        *distance = best_t;
+        return -1;
+    }
+
+    if (bvh->nodes[0].count > 0)
+    {
+        // Small scenes fit in one leaf; skip the box test
+        int hit = sphere_soa_nearest(&bvh->geometry, 0, bvh->sphere_count, ray, distance);
+        return hit >= 0 ? bvh->sphere_index[hit] : -1;
+    }
+
+    Vector3 inv_dir = inverse_direction(ray.direction);
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    int node_index = node_entry(&bvh->nodes[0], ray.origin, inv_dir, best_t) < INFINITY ? 0 : -1;
+
+    while (node_index >= 0)
+    {
+        const BvhNode *node = &bvh->nodes[node_index];
+
+        if (node->count > 0)
+        {
+            float t;
+            int hit = sphere_soa_nearest(&bvh->geometry, node->first, node->count, ray, &t);
+            if (hit >= 0 && t < best_t)
+            {
+                best_t = t;
+                best = hit;
+            }
+            node_index = -1;
+        }
+        else
+        {
+            int near = node->first;
+            int far = node->first + 1;
+            float t_near = node_entry(&bvh->nodes[near], ray.origin, inv_dir, best_t);
+            float t_far = node_entry(&bvh->nodes[far], ray.origin, inv_dir, best_t);
+            if (t_far < t_near)
+            {
+                int swap_index = near;
+                near = far;
+                far = swap_index;
+                float swap_t = t_near;
+                t_near = t_far;
+                t_far = swap_t;
+            }
+
+            if (t_far < INFINITY)
+                stack[stack_size++] = far;
+            node_index = t_near < INFINITY ? near : -1;
+        }
+
+        // Pop until a node is found that can still hold something closer
+        while (node_index < 0 && stack_size > 0)
+        {
+            int candidate = stack[--stack_size];
+            if (node_entry(&bvh->nodes[candidate], ray.origin, inv_dir, best_t) < INFINITY)
+                node_index = candidate;
+        }
+    }
+
+    *distance = best_t;
+    return best >= 0 ? bvh->sphere_index[best] : -1;
+}
+
+// True as soon as any sphere is hit closer than max_distance. When
+// last_occluder is given, that sphere (a BVH-order index from an earlier
+// query) is tried before traversal and is updated with the new blocker.
+bool bvh_occluded(const Bvh *bvh, Ray ray, float max_distance, int *last_occluder)
+{
+    if (bvh->node_count == 0)
+        return false;
+
+    // Any blocker answers the query, so a stale index is still a valid guess
+    if (last_occluder && *last_occluder >= 0 && *last_occluder < bvh->sphere_count &&
+        sphere_soa_occluder(&bvh->geometry, *last_occluder, 1, ray, max_distance) >= 0)
+    {
+        RENDER_STATS_ADD(shadow_early_outs, 1);
+        return true;
+    }
+
+    int blocker = -1;
+    if (bvh->nodes[0].count > 0)
+    {
+        blocker = sphere_soa_occluder(&bvh->geometry, 0, bvh->sphere_count, ray, max_distance);
+    }
+    else
+    {
+        Vector3 inv_dir = inverse_direction(ray.direction);
+        int stack[BVH_STACK_SIZE];
+        int stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0 && blocker < 0)
+        {
+            const BvhNode *node = &bvh->nodes[stack[--stack_size]];
+            if (node_entry(node, ray.origin, inv_dir, max_distance) == INFINITY)
+                continue;
+
+            if (node->count > 0)
+            {
+                blocker = sphere_soa_occluder(&bvh->geometry, node->first, node->count, ray, max_distance);
+            }
+            else
+            {
+                stack[stack_size++] = node->first + 1;
+                stack[stack_size++] = node->first;
+            }
+        }
+    }
+
+    if (blocker >= 0 && last_occluder)
+        *last_occluder = blocker;
+    return blocker >= 0;
+}
+
+// Closest hits for a packet of coherent rays. A node is entered when any ray
+// in the packet can still find a closer hit inside it; leaves are tested with
+// the packet kernel.
+void bvh_closest_hit_packet(const Bvh *bvh, const RayPacket *packet, float *distance, int *index)
+{
+    Vector3 origin[RAY_PACKET_SIZE];
+    Vector3 inv_dir[RAY_PACKET_SIZE];
+
+    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+    {
+        distance[lane] = INFINITY;
+        index[lane] = -1;
+    }
+    if (bvh->node_count == 0)
+        return;
+
+    for (int lane = 0; lane < packet->count; lane++)
+    {
+        origin[lane] = vector3_create(packet->origin_x[lane], packet->origin_y[lane], packet->origin_z[lane]);
+        inv_dir[lane] = inverse_direction(
+            vector3_create(packet->direction_x[lane], packet->direction_y[lane], packet->direction_z[lane]));
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0)
+    {
+        const BvhNode *node = &bvh->nodes[stack[--stack_size]];
+
+        bool visit = false;
+        for (int lane = 0; lane < packet->count && !visit; lane++)
+            visit = node_entry(node, origin[lane], inv_dir[lane], distance[lane]) < INFINITY;
+        if (!visit)
+            continue;
+
+        if (node->count > 0)
+        {
+            ray_packet_nearest(&bvh->geometry, node->first, node->count, packet, distance, index);
+        }
+        else
+        {
+            stack[stack_size++] = node->first + 1;
+            stack[stack_size++] = node->first;
+        }
+    }
+
+    for (int lane = 0; lane < packet->count; lane++)
+    {
+        if (index[lane] >= 0)
+            index[lane] = bvh->sphere_index[index[lane]];
+    }
+}
@@ -0,0 +1,143 @@
+#include "raytracing.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Framebuffers passed from one render thread to one display thread. At any
+// time a buffer is free, being written, ready (the newest finished frame the
+// display has not taken yet) or displayed (the frame the display is showing,
+// kept until it takes the next one). With three buffers the writer never
+// blocks; with two it waits while a finished frame has not been taken.
+
+struct FrameQueue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t buffer_free;
+    Framebuffer *buffers[FRAME_QUEUE_MAX_BUFFERS];
+    int buffer_count;
+    int ready;     // index of the newest finished frame, -1 when none
+    int displayed; // index held by the display, -1 when none
+    unsigned long long skipped; // finished frames replaced before display
+    bool closed;
+};
+
+// buffer_count is 2 or 3; NULL on failure
+FrameQueue *frame_queue_create(int width, int height, int buffer_count)
+{
+    if (buffer_count < 2 || buffer_count > FRAME_QUEUE_MAX_BUFFERS)
+    {
+        fprintf(stderr, "Frame queue needs 2 to %d buffers, got %d\n", FRAME_QUEUE_MAX_BUFFERS, buffer_count);
+        return NULL;
+    }
+
+    FrameQueue *queue = (FrameQueue *)calloc(1, sizeof(FrameQueue));
+    if (!queue)
+        return NULL;
+
+    for (int i = 0; i < buffer_count; i++)
+    {
+        queue->buffers[i] = framebuffer_create(width, height);
+        if (!queue->buffers[i])
+        {
+            for (int j = 0; j < i; j++)
+                framebuffer_destroy(queue->buffers[j]);
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->buffer_count = buffer_count;
+    queue->ready = -1;
+    queue->displayed = -1;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->buffer_free, NULL);
+    return queue;
+}
+
+// Both threads must be done with the queue
+void frame_queue_destroy(FrameQueue *queue)
+{
+    if (!queue)
+        return;
+
+    for (int i = 0; i < queue->buffer_count; i++)
+        framebuffer_destroy(queue->buffers[i]);
+    pthread_cond_destroy(&queue->buffer_free);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
+
+// A buffer to render the next frame into, waiting while none is free.
+// NULL once the queue is closed.
+Framebuffer *frame_queue_begin_write(FrameQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    int index = -1;
+    while (!queue->closed)
+    {
+        // Double buffering never replaces a frame, even before the first display
+        bool must_wait = queue->buffer_count == 2 && queue->ready >= 0;
+        for (int i = 0; i < queue->buffer_count && index < 0 && !must_wait; i++)
+        {
+            if (i != queue->ready && i != queue->displayed)
+                index = i;
+        }
+        if (index >= 0)
+            break;
+        pthread_cond_wait(&queue->buffer_free, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return index >= 0 ? queue->buffers[index] : NULL;
+}
+
+// Publish a finished frame. A ready frame the display never took is
+// dropped and its buffer reused.
+void frame_queue_end_write(FrameQueue *queue, Framebuffer *framebuffer)
+{
+    pthread_mutex_lock(&queue->lock);
+    for (int i = 0; i < queue->buffer_count; i++)
+    {
+        if (queue->buffers[i] != framebuffer)
+            continue;
+        if (queue->ready >= 0)
+            queue->skipped++;
+        queue->ready = i;
+        break;
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// The newest finished frame, or NULL when nothing new was finished since
+// the last call. The returned buffer stays valid until the next call; the
+// one it replaces goes back to the writer.
+Framebuffer *frame_queue_acquire(FrameQueue *queue)
+{
+    Framebuffer *framebuffer = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->ready >= 0)
+    {
+        queue->displayed = queue->ready;
+        queue->ready = -1;
+        framebuffer = queue->buffers[queue->displayed];
+        pthread_cond_signal(&queue->buffer_free);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return framebuffer;
+}
+
+// Wake a writer blocked in frame_queue_begin_write so it can exit
+void frame_queue_close(FrameQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->buffer_free);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Finished frames that were replaced by a newer one before being displayed
+unsigned long long frame_queue_skipped(FrameQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    unsigned long long skipped = queue->skipped;
+    pthread_mutex_unlock(&queue->lock);
+    return skipped;
+}
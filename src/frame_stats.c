@@ -0,0 +1,104 @@
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Frame-time statistics over a sliding window. Percentiles of the last
+// FRAME_STATS_WINDOW frames show stutters that a cumulative average since
+// startup hides, and the window forgets old frames, so a change of settings
+// is reflected within a few seconds.
+
+void frame_stats_init(FrameStats *stats, const char *label, double report_interval)
+{
+    stats->label = label;
+    stats->report_interval = report_interval;
+    frame_stats_reset(stats);
+}
+
+// Forget every recorded frame; the report interval restarts now
+void frame_stats_reset(FrameStats *stats)
+{
+    stats->count = 0;
+    stats->next = 0;
+    stats->total_frames = 0;
+    stats->last_report = timer_seconds();
+}
+
+// Record one frame time, printing a report to stdout whenever
+// report_interval has passed since the last one
+void frame_stats_add(FrameStats *stats, double seconds)
+{
+    stats->times[stats->next] = seconds;
+    stats->next = (stats->next + 1) % FRAME_STATS_WINDOW;
+    if (stats->count < FRAME_STATS_WINDOW)
+        stats->count++;
+    stats->total_frames++;
+
+    if (stats->report_interval > 0.0)
+    {
+        double now = timer_seconds();
+        if (now - stats->last_report >= stats->report_interval)
+        {
+            frame_stats_print(stats, stdout);
+            stats->last_report = now;
+        }
+    }
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, int count, double fraction)
+{
+    int rank = (int)ceil(fraction * count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Summarize the window; false while no frame has been recorded
+bool frame_stats_summarize(const FrameStats *stats, FrameStatsSummary *summary)
+{
+    int count = stats->count;
+    if (count == 0)
+        return false;
+
+    // Oldest first, so consecutive entries are consecutive frames
+    double ordered[FRAME_STATS_WINDOW];
+    int oldest = count < FRAME_STATS_WINDOW ? 0 : stats->next;
+    for (int i = 0; i < count; i++)
+        ordered[i] = stats->times[(oldest + i) % FRAME_STATS_WINDOW];
+
+    double sum = 0.0;
+    double change = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += ordered[i];
+        if (i > 0)
+            change += fabs(ordered[i] - ordered[i - 1]);
+    }
+    summary->frames = count;
+    summary->mean = sum / count;
+    summary->jitter = count > 1 ? change / (count - 1) : 0.0;
+
+    qsort(ordered, (size_t)count, sizeof(double), compare_doubles);
+    summary->p50 = percentile(ordered, count, 0.50);
+    summary->p95 = percentile(ordered, count, 0.95);
+    summary->p99 = percentile(ordered, count, 0.99);
+    summary->max = ordered[count - 1];
+    return true;
+}
+
+void frame_stats_print(const FrameStats *stats, FILE *stream)
+{
+    FrameStatsSummary summary;
+    if (!frame_stats_summarize(stats, &summary))
+        return;
+
+    fprintf(stream, "%s, last %d frames: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms, jitter %.1f ms",
+            stats->label ? stats->label : "Frame time", summary.frames, summary.p50 * 1e3, summary.p95 * 1e3,
+            summary.p99 * 1e3, summary.max * 1e3, summary.jitter * 1e3);
+    fprintf(stream, " (%.1f per second)\n", summary.mean > 0.0 ? 1.0 / summary.mean : 0.0);
+}
@@ -0,0 +1,84 @@
+#include "raytracing.h"
+#include <stdlib.h>
+
+// CPU framebuffer management
+Framebuffer *framebuffer_create(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return NULL;
+
+    Framebuffer *framebuffer = (Framebuffer *)malloc(sizeof(Framebuffer));
+    if (!framebuffer)
+        return NULL;
+
+    framebuffer->pixels = (Uint32 *)calloc((size_t)width * (size_t)height, sizeof(Uint32));
+    if (!framebuffer->pixels)
+    {
+        free(framebuffer);
+        return NULL;
+    }
+
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer->hdr_pixels = NULL;
+    return framebuffer;
+}
+
+void framebuffer_destroy(Framebuffer *framebuffer)
+{
+    if (framebuffer)
+    {
+        free(framebuffer->hdr_pixels);
+        free(framebuffer->pixels);
+        free(framebuffer);
+    }
+}
+
+// Pack an 8-bit color as RGBA8888 (red in the most significant byte)
+Uint32 framebuffer_pack_rgb(Uint8 r, Uint8 g, Uint8 b)
+{
+    return ((Uint32)r << 24) | ((Uint32)g << 16) | ((Uint32)b << 8) | 0xFFu;
+}
+
+// Clamp a floating point channel to [0, 1] and scale it to 8 bits (NaN becomes 255)
+Uint8 framebuffer_quantize(float value)
+{
+    return (Uint8)(fmaxf(0.0f, fminf(1.0f, value)) * 255);
+}
+
+// Clamp a floating point color to [0, 1] and pack it
+Uint32 framebuffer_pack_color(Color color)
+{
+    return framebuffer_pack_rgb(framebuffer_quantize(color.r), framebuffer_quantize(color.g),
+                                framebuffer_quantize(color.b));
+}
+
+void framebuffer_clear(Framebuffer *framebuffer, Uint8 r, Uint8 g, Uint8 b)
+{
+    Uint32 value = framebuffer_pack_rgb(r, g, b);
+    int count = framebuffer->width * framebuffer->height;
+
+    for (int i = 0; i < count; i++)
+    {
+        framebuffer->pixels[i] = value;
+    }
+}
+
+void framebuffer_set_pixel(Framebuffer *framebuffer, int x, int y, Color color)
+{
+    if (x < 0 || y < 0 || x >= framebuffer->width || y >= framebuffer->height)
+        return;
+
+    framebuffer->pixels[y * framebuffer->width + x] = framebuffer_pack_color(color);
+}
+
+// Keep the unclamped color of every pixel as well (needed for PFM output)
+bool framebuffer_enable_hdr(Framebuffer *framebuffer)
+{
+    if (!framebuffer->hdr_pixels)
+    {
+        framebuffer->hdr_pixels = (Color *)calloc((size_t)framebuffer->width * (size_t)framebuffer->height,
+                                                  sizeof(Color));
+    }
+    return framebuffer->hdr_pixels != NULL;
+}
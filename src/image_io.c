@@ -0,0 +1,267 @@
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Image output for offline rendering. None of these need SDL.
+
+static void unpack_rgb(Uint32 pixel, Uint8 *rgb)
+{
+    rgb[0] = (Uint8)(pixel >> 24);
+    rgb[1] = (Uint8)(pixel >> 16);
+    rgb[2] = (Uint8)(pixel >> 8);
+}
+
+static FILE *open_output(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+    }
+    return file;
+}
+
+static int close_output(FILE *file, const char *path)
+{
+    bool failed = ferror(file) != 0;
+    if (fclose(file) != 0 || failed)
+    {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Binary PPM (P6), 8 bits per channel
+int image_write_ppm(const char *path, Framebuffer *framebuffer)
+{
+    FILE *file = open_output(path);
+    if (!file)
+        return -1;
+
+    int width = framebuffer->width;
+    Uint8 *row = (Uint8 *)malloc((size_t)width * 3);
+    if (!row)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, framebuffer->height);
+    for (int y = 0; y < framebuffer->height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            unpack_rgb(framebuffer->pixels[y * width + x], &row[x * 3]);
+        }
+        fwrite(row, 3, (size_t)width, file);
+    }
+
+    free(row);
+    return close_output(file, path);
+}
+
+// Portable float map: unclamped RGB floats, rows stored bottom to top
+int image_write_pfm(const char *path, Framebuffer *framebuffer)
+{
+    if (!framebuffer->hdr_pixels)
+    {
+        fprintf(stderr, "PFM output needs a framebuffer with HDR pixels enabled\n");
+        return -1;
+    }
+
+    FILE *file = open_output(path);
+    if (!file)
+        return -1;
+
+    // Negative scale marks little-endian data
+    Uint32 probe = 1;
+    bool little_endian = *(Uint8 *)&probe == 1;
+    fprintf(file, "PF\n%d %d\n%s\n", framebuffer->width, framebuffer->height,
+            little_endian ? "-1.0" : "1.0");
+
+    for (int y = framebuffer->height - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < framebuffer->width; x++)
+        {
+            Color c = framebuffer->hdr_pixels[y * framebuffer->width + x];
+            float rgb[3] = {c.r, c.g, c.b};
+            fwrite(rgb, sizeof(float), 3, file);
+        }
+    }
+
+    return close_output(file, path);
+}
+
+// PNG writer using stored (uncompressed) deflate blocks, so no zlib is needed
+typedef struct
+{
+    FILE *file;
+    Uint32 crc_table[256];
+    Uint32 crc;
+    Uint32 adler_a;
+    Uint32 adler_b;
+    size_t block_left;
+    size_t data_left;
+} PngStream;
+
+static void png_write_u32(FILE *file, Uint32 value)
+{
+    Uint8 bytes[4] = {(Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value};
+    fwrite(bytes, 1, 4, file);
+}
+
+static void png_crc_init(PngStream *stream)
+{
+    for (Uint32 n = 0; n < 256; n++)
+    {
+        Uint32 c = n;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        stream->crc_table[n] = c;
+    }
+}
+
+// Write bytes that belong to the current chunk's CRC
+static void png_chunk_bytes(PngStream *stream, const Uint8 *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        stream->crc = stream->crc_table[(stream->crc ^ data[i]) & 0xFF] ^ (stream->crc >> 8);
+    }
+    fwrite(data, 1, length, stream->file);
+}
+
+static void png_chunk_begin(PngStream *stream, const char *type, Uint32 length)
+{
+    png_write_u32(stream->file, length);
+    stream->crc = 0xFFFFFFFFu;
+    png_chunk_bytes(stream, (const Uint8 *)type, 4);
+}
+
+static void png_chunk_end(PngStream *stream)
+{
+    png_write_u32(stream->file, stream->crc ^ 0xFFFFFFFFu);
+}
+
+// Append uncompressed image data, opening a new stored block every 65535 bytes
+static void png_deflate_bytes(PngStream *stream, const Uint8 *data, size_t length)
+{
+    while (length > 0)
+    {
+        if (stream->block_left == 0)
+        {
+            size_t block = stream->data_left < 65535 ? stream->data_left : 65535;
+            Uint8 header[5] = {
+                (Uint8)(stream->data_left <= 65535 ? 1 : 0),
+                (Uint8)(block & 0xFF), (Uint8)(block >> 8),
+                (Uint8)(~block & 0xFF), (Uint8)((~block >> 8) & 0xFF)};
+            png_chunk_bytes(stream, header, sizeof(header));
+            stream->block_left = block;
+        }
+
+        size_t count = length < stream->block_left ? length : stream->block_left;
+        for (size_t i = 0; i < count; i++)
+        {
+            stream->adler_a = (stream->adler_a + data[i]) % 65521u;
+            stream->adler_b = (stream->adler_b + stream->adler_a) % 65521u;
+        }
+        png_chunk_bytes(stream, data, count);
+
+        stream->block_left -= count;
+        stream->data_left -= count;
+        data += count;
+        length -= count;
+    }
+}
+
+int image_write_png(const char *path, Framebuffer *framebuffer)
+{
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+    size_t row_bytes = (size_t)width * 3 + 1; // filter byte + RGB
+    size_t data_size = row_bytes * (size_t)height;
+    size_t block_count = (data_size + 65534) / 65535;
+    size_t idat_size = 2 + data_size + block_count * 5 + 4;
+
+    if (idat_size > 0x7FFFFFFFu)
+    {
+        fprintf(stderr, "Image too large for uncompressed PNG output\n");
+        return -1;
+    }
+
+    PngStream *stream = (PngStream *)malloc(sizeof(PngStream));
+    Uint8 *row = (Uint8 *)malloc(row_bytes);
+    FILE *file = (stream && row) ? open_output(path) : NULL;
+    if (!file)
+    {
+        free(row);
+        free(stream);
+        return -1;
+    }
+
+    stream->file = file;
+    png_crc_init(stream);
+
+    static const Uint8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+
+    // IHDR: 8-bit RGB, no interlacing
+    Uint8 ihdr[13] = {
+        (Uint8)(width >> 24), (Uint8)(width >> 16), (Uint8)(width >> 8), (Uint8)width,
+        (Uint8)(height >> 24), (Uint8)(height >> 16), (Uint8)(height >> 8), (Uint8)height,
+        8, 2, 0, 0, 0};
+    png_chunk_begin(stream, "IHDR", sizeof(ihdr));
+    png_chunk_bytes(stream, ihdr, sizeof(ihdr));
+    png_chunk_end(stream);
+
+    // IDAT: zlib header, stored deflate blocks, Adler-32 trailer
+    png_chunk_begin(stream, "IDAT", (Uint32)idat_size);
+    static const Uint8 zlib_header[2] = {0x78, 0x01};
+    png_chunk_bytes(stream, zlib_header, sizeof(zlib_header));
+
+    stream->adler_a = 1;
+    stream->adler_b = 0;
+    stream->block_left = 0;
+    stream->data_left = data_size;
+
+    for (int y = 0; y < height; y++)
+    {
+        row[0] = 0; // no filter
+        for (int x = 0; x < width; x++)
+        {
+            unpack_rgb(framebuffer->pixels[y * width + x], &row[1 + x * 3]);
+        }
+        png_deflate_bytes(stream, row, row_bytes);
+    }
+
+    Uint32 adler = (stream->adler_b << 16) | stream->adler_a;
+    Uint8 trailer[4] = {(Uint8)(adler >> 24), (Uint8)(adler >> 16), (Uint8)(adler >> 8), (Uint8)adler};
+    png_chunk_bytes(stream, trailer, sizeof(trailer));
+    png_chunk_end(stream);
+
+    png_chunk_begin(stream, "IEND", 0);
+    png_chunk_end(stream);
+
+    free(row);
+    free(stream);
+    return close_output(file, path);
+}
+
+// Pick the writer from the file extension
+int image_write(const char *path, Framebuffer *framebuffer)
+{
+    const char *extension = strrchr(path, '.');
+
+    if (extension && strcmp(extension, ".pfm") == 0)
+        return image_write_pfm(path, framebuffer);
+    if (extension && strcmp(extension, ".png") == 0)
+        return image_write_png(path, framebuffer);
+    if (extension && strcmp(extension, ".ppm") == 0)
+        return image_write_ppm(path, framebuffer);
+
+    fprintf(stderr, "Unknown image format for %s (use .ppm, .pfm or .png)\n", path);
+    return -1;
+}
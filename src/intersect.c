@@ -0,0 +1,626 @@
+#define _POSIX_C_SOURCE 200809L // pthread_once under -std=c99
+#include "raytracing.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ray/sphere intersection over the structure-of-arrays sphere copy.
+// Every kernel evaluates the same formula as sphere_intersect in the same
+// order, so the scalar and SIMD paths return bit-identical distances.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INTERSECT_X86 1
+#include <immintrin.h>
+#endif
+
+#define HIT_EPSILON 0.001f
+
+typedef int (*SphereNearestKernel)(const SphereSoA *soa, int first, int count, Ray ray, float *distance);
+typedef int (*SphereOccluderKernel)(const SphereSoA *soa, int first, int count, Ray ray, float max_distance);
+typedef void (*PacketNearestKernel)(const SphereSoA *soa, int first, int count, const RayPacket *packet,
+                                    float *distance, int *index);
+
+static int nearest_scalar(const SphereSoA *soa, int first, int count, Ray ray, float *distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    float four_a = 4 * a;
+    float two_a = 2.0f * a;
+    float nearest_t = INFINITY;
+    int nearest = -1;
+
+    for (int i = first; i < first + count; i++)
+    {
+        float ocx = ray.origin.x - soa->center_x[i];
+        float ocy = ray.origin.y - soa->center_y[i];
+        float ocz = ray.origin.z - soa->center_z[i];
+
+        float b = 2.0f * (ocx * ray.direction.x + ocy * ray.direction.y + ocz * ray.direction.z);
+        float c = (ocx * ocx + ocy * ocy + ocz * ocz) - soa->radius_sq[i];
+        float discriminant = b * b - four_a * c;
+        if (discriminant < 0)
+            continue;
+
+        float sqrt_discriminant = sqrtf(discriminant);
+        float t1 = (-b - sqrt_discriminant) / two_a;
+        float t2 = (-b + sqrt_discriminant) / two_a;
+        float t = (t1 > HIT_EPSILON) ? t1 : t2;
+
+        if (t > HIT_EPSILON && t < nearest_t)
+        {
+            nearest_t = t;
+            nearest = i;
+        }
+    }
+
+    *distance = nearest_t;
+    return nearest;
+}
+
+// Occlusion only: stop at the first sphere hit before max_distance
+static int occluder_scalar(const SphereSoA *soa, int first, int count, Ray ray, float max_distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    float four_a = 4 * a;
+    float two_a = 2.0f * a;
+
+    for (int i = first; i < first + count; i++)
+    {
+        float ocx = ray.origin.x - soa->center_x[i];
+        float ocy = ray.origin.y - soa->center_y[i];
+        float ocz = ray.origin.z - soa->center_z[i];
+
+        float b = 2.0f * (ocx * ray.direction.x + ocy * ray.direction.y + ocz * ray.direction.z);
+        float c = (ocx * ocx + ocy * ocy + ocz * ocz) - soa->radius_sq[i];
+        float discriminant = b * b - four_a * c;
+        if (discriminant < 0)
+            continue;
+
+        float sqrt_discriminant = sqrtf(discriminant);
+        float t1 = (-b - sqrt_discriminant) / two_a;
+        float t2 = (-b + sqrt_discriminant) / two_a;
+        float t = (t1 > HIT_EPSILON) ? t1 : t2;
+
+        if (t > HIT_EPSILON && t < max_distance)
+            return i;
+    }
+
+    return -1;
+}
+
+// Packet fallback: one ray at a time
+static void packet_nearest_scalar(const SphereSoA *soa, int first, int count, const RayPacket *packet,
+                                  float *distance, int *index)
+{
+    for (int lane = 0; lane < packet->count; lane++)
+    {
+        Ray ray;
+        float t;
+        ray.origin = vector3_create(packet->origin_x[lane], packet->origin_y[lane], packet->origin_z[lane]);
+        ray.direction = vector3_create(packet->direction_x[lane], packet->direction_y[lane], packet->direction_z[lane]);
+        int nearest = nearest_scalar(soa, first, count, ray, &t);
+        if (nearest >= 0 && t < distance[lane])
+        {
+            distance[lane] = t;
+            index[lane] = nearest;
+        }
+    }
+}
+
+#ifdef INTERSECT_X86
+// Pick the nearest lane; equal distances resolve to the lower sphere index
+static int reduce_lanes(const float *t, const int *index, int lanes, float *distance)
+{
+    float nearest_t = INFINITY;
+    int nearest = -1;
+
+    for (int i = 0; i < lanes; i++)
+    {
+        if (index[i] >= 0 && (t[i] < nearest_t || (t[i] == nearest_t && index[i] < nearest)))
+        {
+            nearest_t = t[i];
+            nearest = index[i];
+        }
+    }
+
+    *distance = nearest_t;
+    return nearest;
+}
+
+// 4 spheres per iteration
+__attribute__((target("sse2"))) static int nearest_sse(const SphereSoA *soa, int first, int count, Ray ray, float *distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    __m128 ox = _mm_set1_ps(ray.origin.x);
+    __m128 oy = _mm_set1_ps(ray.origin.y);
+    __m128 oz = _mm_set1_ps(ray.origin.z);
+    __m128 dx = _mm_set1_ps(ray.direction.x);
+    __m128 dy = _mm_set1_ps(ray.direction.y);
+    __m128 dz = _mm_set1_ps(ray.direction.z);
+    __m128 four_a = _mm_set1_ps(4 * a);
+    __m128 two_a = _mm_set1_ps(2.0f * a);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 epsilon = _mm_set1_ps(HIT_EPSILON);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 best_t = _mm_set1_ps(INFINITY);
+    __m128i best_index = _mm_set1_epi32(-1);
+    __m128i lane_index = _mm_add_epi32(_mm_set1_epi32(first), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i lane_step = _mm_set1_epi32(4);
+    __m128i lane_end = _mm_set1_epi32(first + count);
+
+    // Lanes past the range are masked off; the arrays are padded so the loads stay in bounds
+    for (int i = first; i < first + count; i += 4)
+    {
+        __m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(&soa->center_x[i]));
+        __m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(&soa->center_y[i]));
+        __m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(&soa->center_z[i]));
+
+        __m128 b = _mm_mul_ps(two, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz)));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+                              _mm_loadu_ps(&soa->radius_sq[i]));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a, c));
+        __m128 valid = _mm_and_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lane_index, lane_end)),
+                                  _mm_cmpge_ps(discriminant, zero));
+        if (_mm_movemask_ps(valid) == 0)
+        {
+            lane_index = _mm_add_epi32(lane_index, lane_step);
+            continue; // most rays miss every sphere in a group; skip the sqrt and divides
+        }
+
+        __m128 sqrt_discriminant = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        __m128 neg_b = _mm_xor_ps(b, sign);
+        __m128 t1 = _mm_div_ps(_mm_sub_ps(neg_b, sqrt_discriminant), two_a);
+        __m128 t2 = _mm_div_ps(_mm_add_ps(neg_b, sqrt_discriminant), two_a);
+        __m128 use_t1 = _mm_cmpgt_ps(t1, epsilon);
+        __m128 t = _mm_or_ps(_mm_and_ps(use_t1, t1), _mm_andnot_ps(use_t1, t2));
+
+        __m128 closer = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, best_t)));
+        best_t = _mm_or_ps(_mm_and_ps(closer, t), _mm_andnot_ps(closer, best_t));
+        __m128i closer_i = _mm_castps_si128(closer);
+        best_index = _mm_or_si128(_mm_and_si128(closer_i, lane_index), _mm_andnot_si128(closer_i, best_index));
+        lane_index = _mm_add_epi32(lane_index, lane_step);
+    }
+
+    float t_lanes[4];
+    int index_lanes[4];
+    _mm_storeu_ps(t_lanes, best_t);
+    _mm_storeu_si128((__m128i *)index_lanes, best_index);
+    return reduce_lanes(t_lanes, index_lanes, 4, distance);
+}
+
+// 8 spheres per iteration
+__attribute__((target("avx2"))) static int nearest_avx2(const SphereSoA *soa, int first, int count, Ray ray, float *distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    __m256 ox = _mm256_set1_ps(ray.origin.x);
+    __m256 oy = _mm256_set1_ps(ray.origin.y);
+    __m256 oz = _mm256_set1_ps(ray.origin.z);
+    __m256 dx = _mm256_set1_ps(ray.direction.x);
+    __m256 dy = _mm256_set1_ps(ray.direction.y);
+    __m256 dz = _mm256_set1_ps(ray.direction.z);
+    __m256 four_a = _mm256_set1_ps(4 * a);
+    __m256 two_a = _mm256_set1_ps(2.0f * a);
+    __m256 two = _mm256_set1_ps(2.0f);
+    __m256 epsilon = _mm256_set1_ps(HIT_EPSILON);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 best_t = _mm256_set1_ps(INFINITY);
+    __m256i best_index = _mm256_set1_epi32(-1);
+    __m256i lane_index = _mm256_add_epi32(_mm256_set1_epi32(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i lane_step = _mm256_set1_epi32(8);
+    __m256i lane_end = _mm256_set1_epi32(first + count);
+
+    for (int i = first; i < first + count; i += 8)
+    {
+        __m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&soa->center_x[i]));
+        __m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&soa->center_y[i]));
+        __m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&soa->center_z[i]));
+
+        __m256 b = _mm256_mul_ps(two, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)),
+                                                    _mm256_mul_ps(ocz, dz)));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                               _mm256_mul_ps(ocz, ocz)),
+                                 _mm256_loadu_ps(&soa->radius_sq[i]));
+        __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(four_a, c));
+        __m256 valid = _mm256_and_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lane_end, lane_index)),
+                                     _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(valid) == 0)
+        {
+            lane_index = _mm256_add_epi32(lane_index, lane_step);
+            continue;
+        }
+
+        __m256 sqrt_discriminant = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        __m256 neg_b = _mm256_xor_ps(b, sign);
+        __m256 t1 = _mm256_div_ps(_mm256_sub_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t2 = _mm256_div_ps(_mm256_add_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, epsilon, _CMP_GT_OQ));
+
+        __m256 closer = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, epsilon, _CMP_GT_OQ),
+                                                           _mm256_cmp_ps(t, best_t, _CMP_LT_OQ)));
+        best_t = _mm256_blendv_ps(best_t, t, closer);
+        best_index = _mm256_blendv_epi8(best_index, lane_index, _mm256_castps_si256(closer));
+        lane_index = _mm256_add_epi32(lane_index, lane_step);
+    }
+
+    float t_lanes[8];
+    int index_lanes[8];
+    _mm256_storeu_ps(t_lanes, best_t);
+    _mm256_storeu_si256((__m256i *)index_lanes, best_index);
+    return reduce_lanes(t_lanes, index_lanes, 8, distance);
+}
+
+// Occlusion: 4 spheres per iteration, returning the first blocking lane
+__attribute__((target("sse2"))) static int occluder_sse(const SphereSoA *soa, int first, int count, Ray ray,
+                                                        float max_distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    __m128 ox = _mm_set1_ps(ray.origin.x);
+    __m128 oy = _mm_set1_ps(ray.origin.y);
+    __m128 oz = _mm_set1_ps(ray.origin.z);
+    __m128 dx = _mm_set1_ps(ray.direction.x);
+    __m128 dy = _mm_set1_ps(ray.direction.y);
+    __m128 dz = _mm_set1_ps(ray.direction.z);
+    __m128 four_a = _mm_set1_ps(4 * a);
+    __m128 two_a = _mm_set1_ps(2.0f * a);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 epsilon = _mm_set1_ps(HIT_EPSILON);
+    __m128 limit = _mm_set1_ps(max_distance);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128i lane_index = _mm_add_epi32(_mm_set1_epi32(first), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i lane_step = _mm_set1_epi32(4);
+    __m128i lane_end = _mm_set1_epi32(first + count);
+
+    for (int i = first; i < first + count; i += 4)
+    {
+        __m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(&soa->center_x[i]));
+        __m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(&soa->center_y[i]));
+        __m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(&soa->center_z[i]));
+
+        __m128 b = _mm_mul_ps(two, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz)));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+                              _mm_loadu_ps(&soa->radius_sq[i]));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a, c));
+        __m128 valid = _mm_and_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lane_index, lane_end)),
+                                  _mm_cmpge_ps(discriminant, zero));
+        lane_index = _mm_add_epi32(lane_index, lane_step);
+        if (_mm_movemask_ps(valid) == 0)
+            continue;
+
+        __m128 sqrt_discriminant = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        __m128 neg_b = _mm_xor_ps(b, sign);
+        __m128 t1 = _mm_div_ps(_mm_sub_ps(neg_b, sqrt_discriminant), two_a);
+        __m128 t2 = _mm_div_ps(_mm_add_ps(neg_b, sqrt_discriminant), two_a);
+        __m128 use_t1 = _mm_cmpgt_ps(t1, epsilon);
+        __m128 t = _mm_or_ps(_mm_and_ps(use_t1, t1), _mm_andnot_ps(use_t1, t2));
+
+        __m128 blocked = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, limit)));
+        int mask = _mm_movemask_ps(blocked);
+        if (mask)
+            return i + __builtin_ctz((unsigned int)mask);
+    }
+
+    return -1;
+}
+
+__attribute__((target("avx2"))) static int occluder_avx2(const SphereSoA *soa, int first, int count, Ray ray,
+                                                         float max_distance)
+{
+    float a = vector3_dot(ray.direction, ray.direction);
+    __m256 ox = _mm256_set1_ps(ray.origin.x);
+    __m256 oy = _mm256_set1_ps(ray.origin.y);
+    __m256 oz = _mm256_set1_ps(ray.origin.z);
+    __m256 dx = _mm256_set1_ps(ray.direction.x);
+    __m256 dy = _mm256_set1_ps(ray.direction.y);
+    __m256 dz = _mm256_set1_ps(ray.direction.z);
+    __m256 four_a = _mm256_set1_ps(4 * a);
+    __m256 two_a = _mm256_set1_ps(2.0f * a);
+    __m256 two = _mm256_set1_ps(2.0f);
+    __m256 epsilon = _mm256_set1_ps(HIT_EPSILON);
+    __m256 limit = _mm256_set1_ps(max_distance);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 zero = _mm256_setzero_ps();
+    __m256i lane_index = _mm256_add_epi32(_mm256_set1_epi32(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i lane_step = _mm256_set1_epi32(8);
+    __m256i lane_end = _mm256_set1_epi32(first + count);
+
+    for (int i = first; i < first + count; i += 8)
+    {
+        __m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&soa->center_x[i]));
+        __m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&soa->center_y[i]));
+        __m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&soa->center_z[i]));
+
+        __m256 b = _mm256_mul_ps(two, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)),
+                                                    _mm256_mul_ps(ocz, dz)));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                               _mm256_mul_ps(ocz, ocz)),
+                                 _mm256_loadu_ps(&soa->radius_sq[i]));
+        __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(four_a, c));
+        __m256 valid = _mm256_and_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lane_end, lane_index)),
+                                     _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ));
+        lane_index = _mm256_add_epi32(lane_index, lane_step);
+        if (_mm256_movemask_ps(valid) == 0)
+            continue;
+
+        __m256 sqrt_discriminant = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        __m256 neg_b = _mm256_xor_ps(b, sign);
+        __m256 t1 = _mm256_div_ps(_mm256_sub_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t2 = _mm256_div_ps(_mm256_add_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, epsilon, _CMP_GT_OQ));
+
+        __m256 blocked = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, epsilon, _CMP_GT_OQ),
+                                                            _mm256_cmp_ps(t, limit, _CMP_LT_OQ)));
+        int mask = _mm256_movemask_ps(blocked);
+        if (mask)
+            return i + __builtin_ctz((unsigned int)mask);
+    }
+
+    return -1;
+}
+
+// Packets: lanes run across rays and each sphere is broadcast, so the sphere
+// loads and the miss test are shared by the whole packet. Per lane this is
+// the same sequence of operations as nearest_scalar.
+__attribute__((target("sse2"))) static void packet_nearest_sse(const SphereSoA *soa, int first, int count,
+                                                               const RayPacket *packet, float *distance, int *index)
+{
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 four = _mm_set1_ps(4.0f);
+    __m128 epsilon = _mm_set1_ps(HIT_EPSILON);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128i lane_count = _mm_set1_epi32(packet->count);
+
+    // Two groups of four rays
+    for (int base = 0; base < packet->count; base += 4)
+    {
+        __m128 ox = _mm_loadu_ps(&packet->origin_x[base]);
+        __m128 oy = _mm_loadu_ps(&packet->origin_y[base]);
+        __m128 oz = _mm_loadu_ps(&packet->origin_z[base]);
+        __m128 dx = _mm_loadu_ps(&packet->direction_x[base]);
+        __m128 dy = _mm_loadu_ps(&packet->direction_y[base]);
+        __m128 dz = _mm_loadu_ps(&packet->direction_z[base]);
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 four_a = _mm_mul_ps(four, a);
+        __m128 two_a = _mm_mul_ps(two, a);
+        __m128i lanes = _mm_add_epi32(_mm_set1_epi32(base), _mm_setr_epi32(0, 1, 2, 3));
+        __m128 active = _mm_castsi128_ps(_mm_cmplt_epi32(lanes, lane_count));
+
+        __m128 best_t = _mm_loadu_ps(&distance[base]);
+        __m128i best_index = _mm_loadu_si128((const __m128i *)&index[base]);
+
+        for (int i = first; i < first + count; i++)
+        {
+            __m128 ocx = _mm_sub_ps(ox, _mm_set1_ps(soa->center_x[i]));
+            __m128 ocy = _mm_sub_ps(oy, _mm_set1_ps(soa->center_y[i]));
+            __m128 ocz = _mm_sub_ps(oz, _mm_set1_ps(soa->center_z[i]));
+
+            __m128 b = _mm_mul_ps(two, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz)));
+            __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+                                  _mm_set1_ps(soa->radius_sq[i]));
+            __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four_a, c));
+            __m128 valid = _mm_and_ps(active, _mm_cmpge_ps(discriminant, zero));
+            if (_mm_movemask_ps(valid) == 0)
+                continue; // the whole group misses this sphere
+
+            __m128 sqrt_discriminant = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+            __m128 neg_b = _mm_xor_ps(b, sign);
+            __m128 t1 = _mm_div_ps(_mm_sub_ps(neg_b, sqrt_discriminant), two_a);
+            __m128 t2 = _mm_div_ps(_mm_add_ps(neg_b, sqrt_discriminant), two_a);
+            __m128 use_t1 = _mm_cmpgt_ps(t1, epsilon);
+            __m128 t = _mm_or_ps(_mm_and_ps(use_t1, t1), _mm_andnot_ps(use_t1, t2));
+
+            __m128 closer = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, best_t)));
+            best_t = _mm_or_ps(_mm_and_ps(closer, t), _mm_andnot_ps(closer, best_t));
+            __m128i closer_i = _mm_castps_si128(closer);
+            best_index = _mm_or_si128(_mm_and_si128(closer_i, _mm_set1_epi32(i)), _mm_andnot_si128(closer_i, best_index));
+        }
+
+        float t_lanes[4];
+        int index_lanes[4];
+        _mm_storeu_ps(t_lanes, best_t);
+        _mm_storeu_si128((__m128i *)index_lanes, best_index);
+        for (int lane = base; lane < packet->count && lane < base + 4; lane++)
+        {
+            distance[lane] = t_lanes[lane - base];
+            index[lane] = index_lanes[lane - base];
+        }
+    }
+}
+
+__attribute__((target("avx2"))) static void packet_nearest_avx2(const SphereSoA *soa, int first, int count,
+                                                                const RayPacket *packet, float *distance, int *index)
+{
+    __m256 two = _mm256_set1_ps(2.0f);
+    __m256 four = _mm256_set1_ps(4.0f);
+    __m256 epsilon = _mm256_set1_ps(HIT_EPSILON);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 ox = _mm256_loadu_ps(packet->origin_x);
+    __m256 oy = _mm256_loadu_ps(packet->origin_y);
+    __m256 oz = _mm256_loadu_ps(packet->origin_z);
+    __m256 dx = _mm256_loadu_ps(packet->direction_x);
+    __m256 dy = _mm256_loadu_ps(packet->direction_y);
+    __m256 dz = _mm256_loadu_ps(packet->direction_z);
+    __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+    __m256 four_a = _mm256_mul_ps(four, a);
+    __m256 two_a = _mm256_mul_ps(two, a);
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 active = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(packet->count), lanes));
+
+    __m256 best_t = _mm256_loadu_ps(distance);
+    __m256i best_index = _mm256_loadu_si256((const __m256i *)index);
+
+    for (int i = first; i < first + count; i++)
+    {
+        __m256 ocx = _mm256_sub_ps(ox, _mm256_set1_ps(soa->center_x[i]));
+        __m256 ocy = _mm256_sub_ps(oy, _mm256_set1_ps(soa->center_y[i]));
+        __m256 ocz = _mm256_sub_ps(oz, _mm256_set1_ps(soa->center_z[i]));
+
+        __m256 b = _mm256_mul_ps(two, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)),
+                                                    _mm256_mul_ps(ocz, dz)));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                               _mm256_mul_ps(ocz, ocz)),
+                                 _mm256_set1_ps(soa->radius_sq[i]));
+        __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(four_a, c));
+        __m256 valid = _mm256_and_ps(active, _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(valid) == 0)
+            continue;
+
+        __m256 sqrt_discriminant = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        __m256 neg_b = _mm256_xor_ps(b, sign);
+        __m256 t1 = _mm256_div_ps(_mm256_sub_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t2 = _mm256_div_ps(_mm256_add_ps(neg_b, sqrt_discriminant), two_a);
+        __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, epsilon, _CMP_GT_OQ));
+
+        __m256 closer = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, epsilon, _CMP_GT_OQ),
+                                                           _mm256_cmp_ps(t, best_t, _CMP_LT_OQ)));
+        best_t = _mm256_blendv_ps(best_t, t, closer);
+        best_index = _mm256_blendv_epi8(best_index, _mm256_set1_epi32(i), _mm256_castps_si256(closer));
+    }
+
+    float t_lanes[RAY_PACKET_SIZE];
+    int index_lanes[RAY_PACKET_SIZE];
+    _mm256_storeu_ps(t_lanes, best_t);
+    _mm256_storeu_si256((__m256i *)index_lanes, best_index);
+    for (int lane = 0; lane < packet->count; lane++)
+    {
+        distance[lane] = t_lanes[lane];
+        index[lane] = index_lanes[lane];
+    }
+}
+#endif
+
+static SphereNearestKernel nearest_kernel = nearest_scalar;
+static SphereOccluderKernel occluder_kernel = occluder_scalar;
+static PacketNearestKernel packet_kernel = packet_nearest_scalar;
+static const char *nearest_kernel_name = "scalar";
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+// Choose the widest kernel the CPU supports; RAYTRACING_SIMD=scalar|sse|avx2 caps it
+static void select_kernel(void)
+{
+#ifdef INTERSECT_X86
+    const char *request = getenv("RAYTRACING_SIMD");
+    bool allow_sse = !request || strcmp(request, "scalar") != 0;
+    bool allow_avx2 = allow_sse && (!request || strcmp(request, "sse") != 0);
+
+    __builtin_cpu_init();
+    if (allow_avx2 && __builtin_cpu_supports("avx2"))
+    {
+        nearest_kernel = nearest_avx2;
+        occluder_kernel = occluder_avx2;
+        packet_kernel = packet_nearest_avx2;
+        nearest_kernel_name = "avx2";
+    }
+    else if (allow_sse && __builtin_cpu_supports("sse2"))
+    {
+        nearest_kernel = nearest_sse;
+        occluder_kernel = occluder_sse;
+        packet_kernel = packet_nearest_sse;
+        nearest_kernel_name = "sse2";
+    }
+#endif
+}
+
+void intersect_init(void)
+{
+    pthread_once(&kernel_once, select_kernel);
+}
+
+const char *intersect_kernel_name(void)
+{
+    intersect_init();
+    return nearest_kernel_name;
+}
+
+// Allocate room for count spheres plus one vector of padding, so a kernel
+// reading a full vector from the last valid index stays in bounds
+bool sphere_soa_init(SphereSoA *soa, int count)
+{
+    int capacity = count + SPHERE_SIMD_WIDTH;
+    float *data = (float *)malloc(sizeof(float) * 4 * (size_t)capacity);
+    if (!data)
+    {
+        fprintf(stderr, "Failed to allocate sphere storage for %d spheres\n", count);
+        return false;
+    }
+
+    soa->center_x = data;
+    soa->center_y = data + capacity;
+    soa->center_z = data + 2 * capacity;
+    soa->radius_sq = data + 3 * capacity;
+    soa->capacity = capacity;
+
+    for (int i = 0; i < capacity; i++)
+    {
+        soa->center_x[i] = 0.0f;
+        soa->center_y[i] = 0.0f;
+        soa->center_z[i] = 0.0f;
+        soa->radius_sq[i] = -INFINITY; // padding never hits
+    }
+    return true;
+}
+
+void sphere_soa_free(SphereSoA *soa)
+{
+    free(soa->center_x); // one allocation backs all four arrays
+    soa->center_x = soa->center_y = soa->center_z = soa->radius_sq = NULL;
+    soa->capacity = 0;
+}
+
+void sphere_soa_set(SphereSoA *soa, int index, Vector3 center, float radius)
+{
+    soa->center_x[index] = center.x;
+    soa->center_y[index] = center.y;
+    soa->center_z[index] = center.z;
+    soa->radius_sq[index] = radius * radius;
+}
+
+// Nearest hit among spheres [first, first + count) beyond the self-intersection
+// epsilon; returns its index or -1
+int sphere_soa_nearest(const SphereSoA *soa, int first, int count, Ray ray, float *distance)
+{
+    RENDER_STATS_ADD(sphere_tests, count);
+    return nearest_kernel(soa, first, count, ray, distance);
+}
+
+// Index of any sphere in [first, first + count) hit before max_distance, or -1.
+// Computes no hit record and stops at the first blocker.
+int sphere_soa_occluder(const SphereSoA *soa, int first, int count, Ray ray, float max_distance)
+{
+    RENDER_STATS_ADD(sphere_tests, count);
+    if (count == 1)
+        return occluder_scalar(soa, first, 1, ray, max_distance); // cached occluder: no vector setup
+    return occluder_kernel(soa, first, count, ray, max_distance);
+}
+
+// Empty packet; unused lanes stay zeroed and are masked off by the kernels
+void ray_packet_clear(RayPacket *packet)
+{
+    memset(packet, 0, sizeof(RayPacket));
+}
+
+void ray_packet_set(RayPacket *packet, int lane, Ray ray)
+{
+    packet->origin_x[lane] = ray.origin.x;
+    packet->origin_y[lane] = ray.origin.y;
+    packet->origin_z[lane] = ray.origin.z;
+    packet->direction_x[lane] = ray.direction.x;
+    packet->direction_y[lane] = ray.direction.y;
+    packet->direction_z[lane] = ray.direction.z;
+}
+
+// Test the packet against spheres [first, first + count). distance and index
+// (RAY_PACKET_SIZE entries) hold each ray's nearest hit so far and are only
+// replaced by strictly closer hits.
+void ray_packet_nearest(const SphereSoA *soa, int first, int count, const RayPacket *packet,
+                        float *distance, int *index)
+{
+    RENDER_STATS_ADD(sphere_tests, count * packet->count);
+    packet_kernel(soa, first, count, packet, distance, index);
+}
@@ -5,22 +5,28 @@
 #define MAX_RAY_DISTANCE 50.0f // no rays beyond this dist
 #define MIN_LIGHT_CONTRIBUTION 0.01F // skip lights with minimal contribution
 
-// Sphere intersection using ray-sphere intersection formula
-bool sphere_intersect(Sphere sphere, Ray ray, HitInfo *hit_info)
+// Helpers that shading kernels are built from; forced inline so each kernel
+// gets its own copy with the feature flags folded to constants
+#if defined(__GNUC__)
+#define SHADE_INLINE static inline __attribute__((always_inline))
+#else
+#define SHADE_INLINE static inline
+#endif
+
+// Sphere intersection using ray-sphere intersection formula. Only the
+// distance is returned; scene_resolve_hit fills in the rest for the closest hit.
+bool sphere_intersect(const Sphere *sphere, Ray ray, float *distance)
 {
-    Vector3 oc = vector3_sub(ray.origin, sphere.center);
+    Vector3 oc = vector3_sub(ray.origin, sphere->center);
 
     float a = vector3_dot(ray.direction, ray.direction);
     float b = 2.0f * vector3_dot(oc, ray.direction);
-    float c = vector3_dot(oc, oc) - sphere.radius * sphere.radius;
+    float c = vector3_dot(oc, oc) - sphere->radius * sphere->radius;
 
     float discriminant = b * b - 4 * a * c;
 
     if (discriminant < 0)
-    {
-        hit_info->hit = false;
         return false;
-    }
 
     float sqrt_discriminant = sqrtf(discriminant);
     float t1 = (-b - sqrt_discriminant) / (2.0f * a);
@@ -30,18 +36,34 @@ bool sphere_intersect(Sphere sphere, Ray ray, HitInfo *hit_info)
 
     if (t > 0.001f)
     {
-        hit_info->hit = true;
-        hit_info->distance = t;
-        hit_info->point = vector3_add(ray.origin, vector3_scale(ray.direction, t));
-        hit_info->normal = vector3_normalize(vector3_sub(hit_info->point, sphere.center));
-        hit_info->material = sphere.material;
+        *distance = t;
         return true;
     }
-
-    hit_info->hit = false;
     return false;
 }
 
+// Phong diffuse and specular light from one light, the single lighting
+// model behind both calculate_lighting and the ray tracer's shading kernels
+SHADE_INLINE Color phong_light(const Material *material, Vector3 normal, Vector3 view_dir,
+                               Vector3 light_dir, const Light *light)
+{
+    // Diffuse lighting (Lambertian)
+    float n_dot_l = fmaxf(0.0f, vector3_dot(normal, light_dir));
+    Color diffuse = color_scale(
+        color_multiply(material->color, light->color),
+        material->diffuse * n_dot_l * light->intensity);
+
+    // Specular lighting (Phong)
+    Vector3 reflect_dir = vector3_reflect(vector3_scale(light_dir, -1.0f), normal);
+    float r_dot_v = fmaxf(0.0f, vector3_dot(reflect_dir, view_dir));
+    float spec_factor = powf(r_dot_v, material->shininess);
+    Color specular = color_scale(
+        light->color,
+        material->specular * spec_factor * light->intensity);
+
+    return color_add(diffuse, specular);
+}
+
 // Improved lighting calculation with Phong shading model
 Color calculate_lighting(Vector3 point, Vector3 normal, Vector3 view_dir,
                          Material material, Light lights[], int light_count)
@@ -51,146 +73,309 @@ Color calculate_lighting(Vector3 point, Vector3 normal, Vector3 view_dir,
     for (int i = 0; i < light_count; i++)
     {
         Vector3 light_dir = vector3_normalize(vector3_sub(lights[i].position, point));
-
-        // Diffuse lighting (Lambertian)
-        float n_dot_l = fmaxf(0.0f, vector3_dot(normal, light_dir));
-        Color diffuse = color_scale(
-            color_multiply(material.color, lights[i].color),
-            material.diffuse * n_dot_l * lights[i].intensity);
-
-        // Specular lighting (Phong)
-        Vector3 reflect_dir = vector3_sub(
-            vector3_scale(normal, 2.0f * vector3_dot(normal, light_dir)),
-            light_dir);
-        float r_dot_v = fmaxf(0.0f, vector3_dot(reflect_dir, view_dir));
-        float spec_factor = powf(r_dot_v, material.shininess);
-        Color specular = color_scale(
-            lights[i].color,
-            material.specular * spec_factor * lights[i].intensity);
-
-        result = color_add(result, color_add(diffuse, specular));
+        result = color_add(result, phong_light(&material, normal, view_dir, light_dir, &lights[i]));
     }
 
     return result;
 }
 
-// Shadow calculation - test if point is in shadow from a light
-bool is_in_shadow(Vector3 point, Vector3 light_pos, Scene *scene)
+// Test every sphere; used while the BVH is out of date
+static int linear_closest_hit(Scene *scene, Ray ray, float *distance)
+{
+    int closest_index = -1;
+    *distance = INFINITY;
+
+    RENDER_STATS_ADD(sphere_tests, scene->sphere_count);
+    for (int i = 0; i < scene->sphere_count; i++)
+    {
+        float t;
+        if (sphere_intersect(&scene->spheres[i], ray, &t) && t < *distance)
+        {
+            *distance = t;
+            closest_index = i;
+        }
+    }
+
+    return closest_index;
+}
+
+// Ray from a surface point towards a light, offset to avoid self-intersection
+Ray shadow_ray_create(Vector3 point, Vector3 light_pos, float *light_distance)
 {
     Vector3 light_dir = vector3_sub(light_pos, point);
-    float light_distance = vector3_length(light_dir);
+    *light_distance = vector3_length(light_dir);
     light_dir = vector3_normalize(light_dir);
 
     Ray shadow_ray;
-    shadow_ray.origin = vector3_add(point, vector3_scale(light_dir, EPSILON)); // Offset to avoid self-intersection
+    shadow_ray.origin = vector3_add(point, vector3_scale(light_dir, EPSILON));
     shadow_ray.direction = light_dir;
+    return shadow_ray;
+}
+
+// Any sphere closer than max_distance along the ray.
+// last_occluder (optional) caches the previous blocker for this light.
+bool scene_occluded(Scene *scene, Ray ray, float max_distance, int *last_occluder)
+{
+    RENDER_STATS_ADD(rays[RAY_SHADOW], 1);
+    if (!scene->bvh_dirty)
+        return bvh_occluded(&scene->bvh, ray, max_distance, last_occluder);
 
+    RENDER_STATS_ADD(sphere_tests, scene->sphere_count);
     for (int i = 0; i < scene->sphere_count; i++)
     {
-        HitInfo hit;
-        if (sphere_intersect(scene->spheres[i], shadow_ray, &hit))
-        {
-            if (hit.distance < light_distance)
-            {
-                return true; // In shadow
-            }
-        }
+        float t;
+        if (sphere_intersect(&scene->spheres[i], ray, &t) && t < max_distance)
+            return true;
     }
     return false;
 }
 
-// Advanced ray tracing with reflections and shadows
-Color trace_ray(Ray ray, Scene *scene, RenderSettings *settings, int depth)
+// Shadow calculation - test if point is in shadow from a light.
+// last_occluder (optional) caches the previous blocker for this light.
+bool is_in_shadow(Vector3 point, Vector3 light_pos, Scene *scene, int *last_occluder)
 {
-    if (depth >= MAX_REFLECTIONS)
+    float light_distance;
+    Ray shadow_ray = shadow_ray_create(point, light_pos, &light_distance);
+    return scene_occluded(scene, shadow_ray, light_distance, last_occluder);
+}
+
+void shadow_cache_reset(ShadowCache *cache)
+{
+    for (int i = 0; i < MAX_LIGHTS; i++)
+        cache->last_occluder[i] = -1;
+}
+
+// Find the closest sphere along a ray; returns its index, or -1 on a miss
+int scene_closest_hit(Scene *scene, Ray ray, HitInfo *closest_hit)
+{
+    float distance;
+    int index = scene->bvh_dirty ? linear_closest_hit(scene, ray, &distance)
+                                 : bvh_closest_hit(&scene->bvh, ray, &distance);
+    scene_resolve_hit(scene, ray, index, distance, closest_hit);
+    return index;
+}
+
+// Closest hit for each ray of a packet (index -1 on a miss)
+void scene_closest_hit_packet(Scene *scene, const RayPacket *packet, float *distance, int *index)
+{
+    if (!scene->bvh_dirty)
     {
-        return scene->background;
+        bvh_closest_hit_packet(&scene->bvh, packet, distance, index);
+        return;
     }
 
-    HitInfo closest_hit;
-    closest_hit.hit = false;
-    closest_hit.distance = INFINITY;
+    for (int lane = 0; lane < packet->count; lane++)
+    {
+        Ray ray;
+        ray.origin = vector3_create(packet->origin_x[lane], packet->origin_y[lane], packet->origin_z[lane]);
+        ray.direction = vector3_create(packet->direction_x[lane], packet->direction_y[lane], packet->direction_z[lane]);
+        index[lane] = linear_closest_hit(scene, ray, &distance[lane]);
+    }
+}
 
-    // Find closest intersection
-    for (int i = 0; i < scene->sphere_count; i++)
+// Fill in hit details from a sphere index and distance (index -1 is a miss)
+void scene_resolve_hit(Scene *scene, Ray ray, int index, float distance, HitInfo *hit)
+{
+    hit->distance = distance;
+    hit->hit = index >= 0;
+    hit->primitive = index;
+    hit->material = NULL;
+    if (index >= 0)
     {
-        HitInfo hit;
-        if (sphere_intersect(scene->spheres[i], ray, &hit))
-        {
-            if (hit.distance < closest_hit.distance)
-            {
-                closest_hit = hit;
-            }
-        }
+        Sphere *sphere = &scene->spheres[index];
+        hit->point = vector3_add(ray.origin, vector3_scale(ray.direction, distance));
+        hit->normal = vector3_normalize(vector3_sub(hit->point, sphere->center));
+        hit->material = &scene->materials[sphere->material_id];
     }
+}
+
+// Advanced ray tracing with reflections and shadows
+Color trace_ray(Ray ray, Scene *scene, RenderSettings *settings, Uint32 path_seed, ShadowCache *shadow_cache)
+{
+    // Find closest intersection
+    HitInfo closest_hit;
+    scene_closest_hit(scene, ray, &closest_hit);
 
     if (!closest_hit.hit && closest_hit.distance > MAX_RAY_DISTANCE)
     {
         return scene->background;
     }
 
+    return shade_hit(ray, &closest_hit, scene, settings, path_seed, shadow_cache);
+}
+
+// Diffuse and specular light from one unshadowed light; false when the
+// light is too far or too weak to contribute
+SHADE_INLINE bool light_contribution_inline(const HitInfo *hit, const Light *light, Vector3 view_dir,
+                                            Color *contribution)
+{
+    Vector3 light_vector = vector3_sub(light->position, hit->point);
+    float light_distance = vector3_length(light_vector);
+
+    if (light_distance > MAX_RAY_DISTANCE || light->intensity < MIN_LIGHT_CONTRIBUTION)
+        return false; // Skip lights that are too far or too weak
+
+    Vector3 light_dir = vector3_normalize(light_vector);
+    *contribution = phong_light(hit->material, hit->normal, view_dir, light_dir, light);
+    return true;
+}
+
+bool light_contribution(const HitInfo *hit, const Light *light, Vector3 view_dir, Color *contribution)
+{
+    return light_contribution_inline(hit, light, view_dir, contribution);
+}
+
+// Direct lighting (shadows, diffuse, specular) plus ambient at one hit
+SHADE_INLINE Color shade_local(Ray ray, HitInfo *hit, Scene *scene, ShadowCache *shadow_cache, bool shadows)
+{
     Vector3 view_dir = vector3_normalize(vector3_scale(ray.direction, -1.0f));
     Color result = color_create(0, 0, 0);
 
-    // Calculate lighting from all light sources
+    // Calculate lighting from all light sources; the shadow ray is only
+    // traced for lights that would contribute
     for (int i = 0; i < scene->light_count; i++)
     {
-        bool in_shadow = settings->enable_shadows &&
-                         is_in_shadow(closest_hit.point, scene->lights[i].position, scene);
+        Color contribution;
+        if (!light_contribution_inline(hit, &scene->lights[i], view_dir, &contribution))
+            continue;
 
+        bool in_shadow = shadows &&
+                         is_in_shadow(hit->point, scene->lights[i].position, scene,
+                                      shadow_cache ? &shadow_cache->last_occluder[i] : NULL);
         if (!in_shadow)
-        {
-            Vector3 light_vector = vector3_sub(scene->lights[i].position, closest_hit.point);
-            float light_distance = vector3_length(light_vector);
-            
-            if (light_distance > MAX_RAY_DISTANCE || scene->lights[i].intensity < MIN_LIGHT_CONTRIBUTION)
-            continue; // Skip lights that are too far or too weak
-            
-            Vector3 light_dir = vector3_normalize(light_vector);
-            // Diffuse lighting
-            float n_dot_l = fmaxf(0.0f, vector3_dot(closest_hit.normal, light_dir));
-            Color diffuse = color_scale(
-                color_multiply(closest_hit.material.color, scene->lights[i].color),
-                closest_hit.material.diffuse * n_dot_l * scene->lights[i].intensity);
-
-            // Specular lighting
-            Vector3 reflect_dir = vector3_reflect(vector3_scale(light_dir, -1.0f), closest_hit.normal);
-            float r_dot_v = fmaxf(0.0f, vector3_dot(reflect_dir, view_dir));
-            float spec_factor = powf(r_dot_v, closest_hit.material.shininess);
-            Color specular = color_scale(
-                scene->lights[i].color,
-                closest_hit.material.specular * spec_factor * scene->lights[i].intensity);
-
-            result = color_add(result, color_add(diffuse, specular));
-        }
+            result = color_add(result, contribution);
     }
 
     // Add ambient lighting
-    Color ambient = color_scale(closest_hit.material.color, closest_hit.material.ambient);
-    result = color_add(result, ambient);
+    Color ambient = color_scale(hit->material->color, hit->material->ambient);
+    return color_add(result, ambient);
+}
 
-    // Add reflections
-    if (settings->enable_reflections && closest_hit.material.specular > MIN_REFLECTION_CONTRIBUTION)
+// What follows a hit at the given depth: stop, see only the background, or
+// reflect. Scales *throughput by the bounce weight (and the roulette
+// reweighting) when the path continues.
+SHADE_INLINE PathStep path_bounce(const Material *material, RenderSettings *settings, int depth,
+                                  Uint32 path_seed, float *throughput)
+{
+    int max_depth = settings->max_depth > 0 ? settings->max_depth : MAX_REFLECTIONS;
+    bool roulette = settings->roulette_threshold > 0.0f;
+    float weight = material->specular * settings->reflection_strength;
+    if (roulette)
     {
-        float reflection_contribution = closest_hit.material.specular * settings->reflection_strength;
-        if (reflection_contribution < MIN_REFLECTION_CONTRIBUTION)
-            return result; // Skip negligible reflections
-
-        Vector3 reflect_dir = vector3_reflect(ray.direction, closest_hit.normal);
-        Ray reflect_ray;
-        reflect_ray.origin = vector3_add(closest_hit.point, vector3_scale(closest_hit.normal, EPSILON));
-        reflect_ray.direction = reflect_dir;
-
-        Color reflection = trace_ray(reflect_ray, scene, settings, depth + 1);
-        reflection = color_scale(reflection, closest_hit.material.specular * settings->reflection_strength);
-        result = color_add(result, reflection);
+        if (weight <= 0.0f)
+            return PATH_STOP;
     }
+    else if (material->specular <= MIN_REFLECTION_CONTRIBUTION || weight < MIN_REFLECTION_CONTRIBUTION)
+    {
+        return PATH_STOP; // Skip negligible reflections
+    }
+
+    *throughput *= weight;
+
+    // The bounce past the last allowed depth sees only the background
+    if (depth + 1 >= max_depth)
+        return PATH_BACKGROUND;
 
+    if (roulette && *throughput < settings->roulette_threshold)
+    {
+        float survive = *throughput / settings->roulette_threshold;
+        if (random_float(path_seed, (Uint32)depth, 0, 0) >= survive)
+            return PATH_STOP;
+        *throughput /= survive;
+    }
+    return PATH_REFLECT;
+}
+
+PathStep path_next_bounce(const Material *material, RenderSettings *settings, int depth,
+                          Uint32 path_seed, float *throughput)
+{
+    if (!settings->enable_reflections)
+        return PATH_STOP;
+    return path_bounce(material, settings, depth, path_seed, throughput);
+}
+
+// Mirror ray leaving a hit, offset along the normal
+Ray reflect_ray_create(Ray ray, const HitInfo *hit)
+{
+    Ray reflect_ray;
+    reflect_ray.origin = vector3_add(hit->point, vector3_scale(hit->normal, EPSILON));
+    reflect_ray.direction = vector3_reflect(ray.direction, hit->normal);
+    return reflect_ray;
+}
+
+// Shade a known hit and follow its reflection bounces in a loop. Each bounce
+// scales the path throughput by specular * reflection_strength. With
+// Russian roulette enabled (roulette_threshold > 0), a path whose throughput
+// has dropped below the threshold survives with probability
+// throughput / threshold and is reweighted by the inverse, which keeps the
+// estimate unbiased; otherwise the fixed MIN_REFLECTION_CONTRIBUTION cutoff
+// applies. Either way no path exceeds the maximum depth.
+SHADE_INLINE Color shade_path(Ray ray, HitInfo *hit, Scene *scene, RenderSettings *settings, Uint32 path_seed,
+                              ShadowCache *shadow_cache, bool shadows, bool reflections)
+{
+    Color result = color_create(0, 0, 0);
+    float throughput = 1.0f;
+    HitInfo bounce = *hit;
+
+    int depth = 0;
+    for (;; depth++)
+    {
+        result = color_add(result, color_scale(shade_local(ray, &bounce, scene, shadow_cache, shadows), throughput));
+
+        if (!reflections)
+            break;
+
+        PathStep step = path_bounce(bounce.material, settings, depth, path_seed, &throughput);
+        if (step == PATH_BACKGROUND)
+            result = color_add(result, color_scale(scene->background, throughput));
+        if (step != PATH_REFLECT)
+            break;
+
+        ray = reflect_ray_create(ray, &bounce);
+        RENDER_STATS_ADD(rays[RAY_REFLECTION], 1);
+        scene_closest_hit(scene, ray, &bounce);
+        if (!bounce.hit)
+        {
+            result = color_add(result, color_scale(scene->background, throughput));
+            depth++; // count the reflection ray that missed
+            break;
+        }
+    }
+
+    RENDER_STATS_DEPTH(depth);
     return result;
 }
 
+// One shading kernel per combination of the shadow and reflection flags
+#define SHADE_KERNEL(name, shadows, reflections)                                                   \
+    static Color name(Ray ray, HitInfo *hit, Scene *scene, RenderSettings *settings, Uint32 path_seed, \
+                      ShadowCache *shadow_cache)                                                      \
+    {                                                                                                 \
+        return shade_path(ray, hit, scene, settings, path_seed, shadow_cache, shadows, reflections);  \
+    }
+
+SHADE_KERNEL(shade_direct, false, false)
+SHADE_KERNEL(shade_shadows, true, false)
+SHADE_KERNEL(shade_reflections, false, true)
+SHADE_KERNEL(shade_shadows_reflections, true, true)
+
+// Pick the kernel for these settings; callers look it up once per frame
+ShadeKernel shade_kernel_select(const RenderSettings *settings)
+{
+    static const ShadeKernel kernels[2][2] = {
+        {shade_direct, shade_reflections},
+        {shade_shadows, shade_shadows_reflections}};
+    return kernels[settings->enable_shadows ? 1 : 0][settings->enable_reflections ? 1 : 0];
+}
+
+Color shade_hit(Ray ray, HitInfo *hit, Scene *scene, RenderSettings *settings, Uint32 path_seed,
+                ShadowCache *shadow_cache)
+{
+    return shade_kernel_select(settings)(ray, hit, scene, settings, path_seed, shadow_cache);
+}
+
 // Simplified sphere drawing for rasterization examples
-void draw_sphere_simple(SDL_Renderer *renderer, int center_x, int center_y,
+void draw_sphere_simple(Framebuffer *framebuffer, int center_x, int center_y,
                         int radius, Vector3 light_pos)
 {
     for (int y = -radius; y <= radius; y++)
@@ -209,10 +394,8 @@ void draw_sphere_simple(SDL_Renderer *renderer, int center_x, int center_y,
 
                 // Simple diffuse lighting
                 float intensity = fmaxf(0.1f, vector3_dot(normal, light_dir));
-                Uint8 shade = (Uint8)(intensity * 255);
-
-                SDL_SetRenderDrawColor(renderer, shade, shade, shade, 255);
-                SDL_RenderDrawPoint(renderer, center_x + x, center_y + y);
+                framebuffer_set_pixel(framebuffer, center_x + x, center_y + y,
+                                      color_create(intensity, intensity, intensity));
             }
         }
     }
@@ -0,0 +1,111 @@
+#include "raytracing.h"
+#include <ctype.h>
+#include <string.h>
+
+// Minimal text rendering for on-screen diagnostics, with no dependency on
+// SDL_ttf: a 5x7 bitmap font covering digits, upper case letters and the
+// punctuation the overlays use, drawn at twice its size. Lower case letters
+// are shown in upper case; anything else is drawn as a blank.
+
+#define OVERLAY_SCALE 2
+
+static const char glyph_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ:.%/-+=()<>,_";
+
+// One byte per row, bit 4 is the leftmost column
+static const Uint8 glyph_rows[][7] = {
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // +
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // =
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // <
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // >
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // _
+};
+
+static void fill_pixel(Framebuffer *framebuffer, int x, int y, Uint32 color)
+{
+    if (x >= 0 && y >= 0 && x < framebuffer->width && y < framebuffer->height)
+        framebuffer->pixels[y * framebuffer->width + x] = color;
+}
+
+// Darken a rectangle to a quarter of its brightness so text stays readable
+void overlay_draw_panel(Framebuffer *framebuffer, int x, int y, int width, int height)
+{
+    int x0 = x > 0 ? x : 0;
+    int y0 = y > 0 ? y : 0;
+    int x1 = x + width < framebuffer->width ? x + width : framebuffer->width;
+    int y1 = y + height < framebuffer->height ? y + height : framebuffer->height;
+
+    for (int row = y0; row < y1; row++)
+    {
+        Uint32 *pixel = framebuffer->pixels + row * framebuffer->width;
+        for (int column = x0; column < x1; column++)
+            pixel[column] = ((pixel[column] >> 2) & 0x3F3F3F00u) | 0xFFu;
+    }
+}
+
+// Draw a line of text with its top left corner at (x, y); packed RGBA color
+void overlay_draw_text(Framebuffer *framebuffer, int x, int y, const char *text, Uint32 color)
+{
+    for (; *text; text++, x += OVERLAY_CHAR_WIDTH)
+    {
+        const char *found = strchr(glyph_chars, toupper((unsigned char)*text));
+        if (!found)
+            continue;
+
+        const Uint8 *rows = glyph_rows[found - glyph_chars];
+        for (int row = 0; row < 7; row++)
+        {
+            for (int column = 0; column < 5; column++)
+            {
+                if (!(rows[row] & (0x10 >> column)))
+                    continue;
+                for (int dy = 0; dy < OVERLAY_SCALE; dy++)
+                    for (int dx = 0; dx < OVERLAY_SCALE; dx++)
+                        fill_pixel(framebuffer, x + column * OVERLAY_SCALE + dx, y + row * OVERLAY_SCALE + dy, color);
+            }
+        }
+    }
+}
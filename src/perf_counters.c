@@ -0,0 +1,170 @@
+#define _GNU_SOURCE // syscall()
+#include "raytracing.h"
+#include <errno.h>
+#include <string.h>
+
+// Hardware performance counters through Linux perf_event_open. Counters
+// follow the calling process and every thread it creates afterwards, so
+// open them before starting a thread pool. Each counter is optional: a
+// kernel, VM or container without it just leaves that value unavailable,
+// and elsewhere nothing can be opened at all.
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_COUNTERS_SUPPORTED 1
+#endif
+
+static const char *counter_names[PERF_COUNTER_COUNT] = {"cycles", "instructions", "l1d_misses", "llc_misses",
+                                                         "branch_misses"};
+
+const char *perf_counter_name(PerfCounterKind kind)
+{
+    return kind >= 0 && kind < PERF_COUNTER_COUNT ? counter_names[kind] : "unknown";
+}
+
+#ifdef PERF_COUNTERS_SUPPORTED
+#define PERF_GROUP_FORMAT (PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING)
+
+// Open one event; group is -1 for the leader, which starts disabled and
+// enables or disables its members with it
+static int open_counter(Uint32 type, Uint64 config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0;
+    attr.inherit = 1;        // include render threads started later
+    attr.exclude_kernel = 1; // allowed at the default perf_event_paranoid level
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_GROUP_FORMAT;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Counts in member order plus the group's enabled and running times, all
+// taken in one read so they describe the same instant
+static bool read_group(const PerfCounters *counters, Uint64 *values, Uint64 *enabled, Uint64 *running)
+{
+    Uint64 data[3 + PERF_COUNTER_COUNT]; // member count, time enabled, time running, values
+    ssize_t size = (ssize_t)(sizeof(Uint64) * (size_t)(3 + counters->member_count));
+    if (read(counters->group, data, sizeof(data)) != size || data[0] != (Uint64)counters->member_count)
+        return false;
+    *enabled = data[1];
+    *running = data[2];
+    for (int i = 0; i < counters->member_count; i++)
+        values[i] = data[3 + i];
+    return true;
+}
+#endif
+
+// Open every counter the system provides as one group; returns how many.
+// An event the hardware cannot schedule alongside the others is left out.
+// When none can be opened the reason is printed once and the caller carries
+// on without.
+int perf_counters_open(PerfCounters *counters)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        counters->fds[i] = -1;
+    counters->group = -1;
+    counters->member_count = 0;
+    counters->start_enabled = 0;
+    counters->start_running = 0;
+
+#ifdef PERF_COUNTERS_SUPPORTED
+    static const Uint64 cache_read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    static const Uint32 types[PERF_COUNTER_COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                                     PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    static const Uint64 configs[PERF_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_L1D | cache_read_miss,
+        PERF_COUNT_HW_CACHE_LL | cache_read_miss, PERF_COUNT_HW_BRANCH_MISSES};
+
+    int error = 0;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        int fd = open_counter(types[i], configs[i], counters->group);
+        if (fd < 0)
+        {
+            if (error == 0)
+                error = errno;
+            continue;
+        }
+        counters->fds[i] = fd;
+        if (counters->group < 0)
+            counters->group = fd;
+        counters->members[counters->member_count++] = (PerfCounterKind)i;
+    }
+
+    if (counters->member_count == 0)
+        fprintf(stderr, "Hardware counters unavailable (%s); reporting time only\n", strerror(error));
+#else
+    fprintf(stderr, "Hardware counters need Linux perf_event_open; reporting time only\n");
+#endif
+    return counters->member_count;
+}
+
+void perf_counters_close(PerfCounters *counters)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+#ifdef PERF_COUNTERS_SUPPORTED
+        if (counters->fds[i] >= 0)
+            close(counters->fds[i]);
+#endif
+        counters->fds[i] = -1;
+    }
+    counters->group = -1;
+    counters->member_count = 0;
+}
+
+// Zero and start the counters. Resetting clears the counts but not the
+// group's enabled and running times, so those are remembered here and
+// perf_counters_stop scales by their change.
+void perf_counters_start(PerfCounters *counters)
+{
+#ifdef PERF_COUNTERS_SUPPORTED
+    if (counters->group < 0)
+        return;
+    ioctl(counters->group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    Uint64 values[PERF_COUNTER_COUNT];
+    if (!read_group(counters, values, &counters->start_enabled, &counters->start_running))
+        counters->start_enabled = counters->start_running = 0;
+    ioctl(counters->group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)counters;
+#endif
+}
+
+// Stop the counters and read what they saw since perf_counters_start. When
+// the kernel had to share the hardware with other events, the group only
+// counted part of the time; values are scaled up by that fraction.
+void perf_counters_stop(PerfCounters *counters, PerfReading *reading)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        reading->values[i] = 0.0;
+        reading->valid[i] = false;
+    }
+
+#ifdef PERF_COUNTERS_SUPPORTED
+    if (counters->group < 0)
+        return;
+    ioctl(counters->group, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    Uint64 values[PERF_COUNTER_COUNT];
+    Uint64 enabled, running;
+    if (!read_group(counters, values, &enabled, &running) || running <= counters->start_running)
+        return;
+    double scale = (double)(enabled - counters->start_enabled) / (double)(running - counters->start_running);
+    for (int i = 0; i < counters->member_count; i++)
+    {
+        reading->values[counters->members[i]] = (double)values[i] * scale;
+        reading->valid[counters->members[i]] = true;
+    }
+#else
+    (void)counters;
+#endif
+}
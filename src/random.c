@@ -0,0 +1,34 @@
+#include "raytracing.h"
+
+// Stateless counter-based random numbers. Every value is a pure function of
+// (frame, pixel, sample, dimension), so worker threads share no RNG state and a
+// pixel gets the same jitter whichever thread renders it.
+
+// PCG output permutation used as an integer hash
+Uint32 random_hash(Uint32 value)
+{
+    Uint32 state = value * 747796405u + 2891336453u;
+    Uint32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+Uint32 random_hash4(Uint32 a, Uint32 b, Uint32 c, Uint32 d)
+{
+    Uint32 h = random_hash(a);
+    h = random_hash(h ^ b);
+    h = random_hash(h ^ c);
+    return random_hash(h ^ d);
+}
+
+// Uniform float in [0, 1) from the top 24 bits of the hash
+float random_float(Uint32 frame, Uint32 pixel, Uint32 sample, Uint32 dimension)
+{
+    return (float)(random_hash4(frame, pixel, sample, dimension) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Seed for the random decisions along one camera sample's path; dimensions
+// 0 and 1 of the same counter are the pixel jitter
+Uint32 random_path_seed(Uint32 seed, Uint32 pixel, int sample)
+{
+    return random_hash4(seed, pixel, (Uint32)sample, 2);
+}
@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L // posix_memalign under -std=c99
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Per-frame render counters. Each pool thread counts into its own padded
+// slot through render_stats_thread; the renderer merges the slots once the
+// frame's tiles are done, so counting never touches shared cache lines.
+
+#define STATS_TEXT_COLOR 0xFFFFFFFFu
+#define STATS_PANEL_MARGIN 8
+
+#ifdef RAYTRACING_STATS
+#define STATS_ENABLED true
+// Shared by every unbound thread; lost updates don't matter since it is never read
+static RenderStats scratch_stats;
+__thread RenderStats *render_stats_thread = &scratch_stats;
+#else
+#define STATS_ENABLED false
+#endif
+
+static const char *ray_type_names[RAY_TYPE_COUNT] = {"camera", "shadow", "reflection"};
+
+// Zeroed, cache-line aligned counter slots, or NULL on failure
+RenderStatsSlot *render_stats_create_slots(int count)
+{
+    void *memory = NULL;
+    if (count < 1 || posix_memalign(&memory, 64, sizeof(RenderStatsSlot) * (size_t)count) != 0)
+        return NULL;
+    memset(memory, 0, sizeof(RenderStatsSlot) * (size_t)count);
+    return memory;
+}
+
+// Point the calling thread's counters at stats (NULL: back to scratch)
+void render_stats_bind(RenderStats *stats)
+{
+#ifdef RAYTRACING_STATS
+    render_stats_thread = stats ? stats : &scratch_stats;
+#else
+    (void)stats;
+#endif
+}
+
+// total = sum of the slots; the slots are cleared for the next frame
+void render_stats_merge(RenderStats *total, RenderStatsSlot *slots, int count)
+{
+    memset(total, 0, sizeof(*total));
+#ifdef RAYTRACING_STATS
+    for (int i = 0; i < count; i++)
+    {
+        const RenderStats *stats = &slots[i].stats;
+        for (int type = 0; type < RAY_TYPE_COUNT; type++)
+            total->rays[type] += stats->rays[type];
+        total->sphere_tests += stats->sphere_tests;
+        total->shadow_early_outs += stats->shadow_early_outs;
+        for (int depth = 0; depth < RENDER_STATS_DEPTHS; depth++)
+            total->path_depths[depth] += stats->path_depths[depth];
+        memset(&slots[i].stats, 0, sizeof(RenderStats));
+    }
+#else
+    (void)slots;
+    (void)count;
+#endif
+}
+
+static unsigned long long total_rays(const RenderStats *stats)
+{
+    unsigned long long total = 0;
+    for (int type = 0; type < RAY_TYPE_COUNT; type++)
+        total += stats->rays[type];
+    return total;
+}
+
+static double percent(unsigned long long part, unsigned long long whole)
+{
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+void render_stats_print(const RenderStats *stats, FILE *stream)
+{
+    if (!STATS_ENABLED)
+    {
+        fprintf(stream, "Render statistics unavailable (build with RAYTRACING_STATS)\n");
+        return;
+    }
+
+    unsigned long long rays = total_rays(stats);
+    fprintf(stream, "Rays: %llu\n", rays);
+    for (int type = 0; type < RAY_TYPE_COUNT; type++)
+        fprintf(stream, "  %-10s %12llu\n", ray_type_names[type], stats->rays[type]);
+    fprintf(stream, "Sphere tests: %llu (%.1f per ray)\n", stats->sphere_tests,
+            rays ? (double)stats->sphere_tests / (double)rays : 0.0);
+    fprintf(stream, "Shadow early outs: %llu (%.1f%% of shadow rays)\n", stats->shadow_early_outs,
+            percent(stats->shadow_early_outs, stats->rays[RAY_SHADOW]));
+
+    unsigned long long paths = 0;
+    for (int depth = 0; depth < RENDER_STATS_DEPTHS; depth++)
+        paths += stats->path_depths[depth];
+    fprintf(stream, "Path depth (reflection rays per shaded path):\n");
+    for (int depth = 0; depth < RENDER_STATS_DEPTHS; depth++)
+    {
+        fprintf(stream, "  %d%s %12llu (%5.1f%%)\n", depth, depth == RENDER_STATS_DEPTHS - 1 ? "+" : " ",
+                stats->path_depths[depth], percent(stats->path_depths[depth], paths));
+    }
+}
+
+// Large counts shortened to K/M/G so overlay lines stay narrow
+static void format_count(char *text, size_t size, unsigned long long count)
+{
+    if (count >= 1000000000ull)
+        snprintf(text, size, "%.1fG", (double)count * 1e-9);
+    else if (count >= 1000000ull)
+        snprintf(text, size, "%.1fM", (double)count * 1e-6);
+    else if (count >= 100000ull)
+        snprintf(text, size, "%.1fK", (double)count * 1e-3);
+    else
+        snprintf(text, size, "%llu", count);
+}
+
+// Counters of the last frame in a panel at the top left corner
+void render_stats_draw(Framebuffer *framebuffer, const RenderStats *stats)
+{
+    char lines[8 + RENDER_STATS_DEPTHS][48];
+    int line_count = 0;
+
+    char count[16];
+    if (!STATS_ENABLED)
+    {
+        snprintf(lines[line_count++], sizeof(lines[0]), "stats off");
+        snprintf(lines[line_count++], sizeof(lines[0]), "build with RAYTRACING_STATS");
+    }
+    else
+    {
+        for (int type = 0; type < RAY_TYPE_COUNT; type++)
+        {
+            format_count(count, sizeof(count), stats->rays[type]);
+            snprintf(lines[line_count++], sizeof(lines[0]), "%-11s %8s", ray_type_names[type], count);
+        }
+        format_count(count, sizeof(count), stats->sphere_tests);
+        snprintf(lines[line_count++], sizeof(lines[0]), "%-11s %8s", "tests", count);
+        snprintf(lines[line_count++], sizeof(lines[0]), "%-11s %7.1f%%", "early out",
+                 percent(stats->shadow_early_outs, stats->rays[RAY_SHADOW]));
+        for (int depth = 0; depth < RENDER_STATS_DEPTHS; depth++)
+        {
+            format_count(count, sizeof(count), stats->path_depths[depth]);
+            snprintf(lines[line_count++], sizeof(lines[0]), "depth %d%-4s %8s", depth,
+                     depth == RENDER_STATS_DEPTHS - 1 ? "+" : "", count);
+        }
+    }
+
+    int columns = 0;
+    for (int i = 0; i < line_count; i++)
+    {
+        int length = (int)strlen(lines[i]);
+        if (length > columns)
+            columns = length;
+    }
+
+    overlay_draw_panel(framebuffer, 0, 0, columns * OVERLAY_CHAR_WIDTH + 2 * STATS_PANEL_MARGIN,
+                       line_count * OVERLAY_LINE_HEIGHT + 2 * STATS_PANEL_MARGIN);
+    for (int i = 0; i < line_count; i++)
+    {
+        overlay_draw_text(framebuffer, STATS_PANEL_MARGIN, STATS_PANEL_MARGIN + i * OVERLAY_LINE_HEIGHT, lines[i],
+                          STATS_TEXT_COLOR);
+    }
+}
@@ -0,0 +1,646 @@
+#define _POSIX_C_SOURCE 200809L // posix_memalign under -std=c99
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Work description shared by every tile of one frame
+typedef struct
+{
+    Framebuffer *framebuffer;
+    Scene *scene;
+    Camera *camera;
+    RenderSettings *settings;
+    ShadeKernel shade; // picked from the settings once per frame
+    int tile_size;
+    int tiles_x;
+    Uint32 frame_index;
+    Color *accumulation; // NULL unless accumulating progressively
+    int accumulated_samples;
+    int new_samples;
+    GBufferSample *gbuffer; // NULL unless shading from cached primary hits
+    bool gbuffer_fill;      // trace primary rays and store their hits first
+    ShadowCache *shadow_caches; // indexed by pool thread
+    WavefrontQueues **wavefront_queues; // indexed by pool thread
+    RenderStatsSlot *thread_stats;      // indexed by pool thread
+    unsigned long long samples_traced; // summed across tiles atomically
+} TileJob;
+
+// Render context management
+RenderContext *render_context_create(int thread_count)
+{
+    RenderContext *context = (RenderContext *)malloc(sizeof(RenderContext));
+    if (!context)
+        return NULL;
+
+    context->thread_pool = thread_pool_create(thread_count);
+    if (!context->thread_pool)
+    {
+        free(context);
+        return NULL;
+    }
+
+    int threads = thread_pool_size(context->thread_pool);
+    // Cache line aligned so each thread's entry sits on a line of its own
+    void *shadow_caches = NULL;
+    if (posix_memalign(&shadow_caches, 64, sizeof(ShadowCache) * (size_t)threads) != 0)
+    {
+        thread_pool_destroy(context->thread_pool);
+        free(context);
+        return NULL;
+    }
+    context->shadow_caches = (ShadowCache *)shadow_caches;
+    for (int i = 0; i < threads; i++)
+        shadow_cache_reset(&context->shadow_caches[i]);
+
+    context->wavefront_queues = (WavefrontQueues **)calloc((size_t)threads, sizeof(WavefrontQueues *));
+    if (!context->wavefront_queues)
+    {
+        free(context->shadow_caches);
+        thread_pool_destroy(context->thread_pool);
+        free(context);
+        return NULL;
+    }
+
+    context->thread_stats = render_stats_create_slots(threads);
+    if (!context->thread_stats)
+    {
+        free(context->wavefront_queues);
+        free(context->shadow_caches);
+        thread_pool_destroy(context->thread_pool);
+        free(context);
+        return NULL;
+    }
+    memset(&context->stats, 0, sizeof(context->stats));
+
+    context->tile_size = RENDER_TILE_SIZE;
+    context->frame_index = 0;
+    context->accumulation = NULL;
+    context->accumulation_size = 0;
+    context->accumulated_samples = 0;
+    context->last_frame.valid = false;
+    context->gbuffer = NULL;
+    context->gbuffer_size = 0;
+    context->gbuffer_valid = false;
+    context->samples_traced = 0;
+    frame_stats_init(&context->frame_stats, "Render time", 0.0);
+    return context;
+}
+
+void render_context_destroy(RenderContext *context)
+{
+    if (context)
+    {
+        for (int i = 0; i < thread_pool_size(context->thread_pool); i++)
+            wavefront_destroy(context->wavefront_queues[i]);
+        thread_pool_destroy(context->thread_pool);
+        free(context->accumulation);
+        free(context->gbuffer);
+        free(context->shadow_caches);
+        free(context->wavefront_queues);
+        free(context->thread_stats);
+        free(context);
+    }
+}
+
+// True while another frame with unchanged inputs would still add
+// progressive samples; otherwise it would reproduce the last image
+bool render_context_refining(const RenderContext *context, const RenderSettings *settings)
+{
+    return settings->enable_anti_aliasing && settings->enable_progressive && context->accumulation &&
+           context->accumulated_samples < settings->progressive_max_samples;
+}
+
+// Closest hit of a camera ray, shaded with the frame's kernel
+static Color trace_camera_ray(TileJob *job, ShadowCache *shadow_cache, Ray ray, Uint32 path_seed)
+{
+    HitInfo hit;
+    RENDER_STATS_ADD(rays[RAY_CAMERA], 1);
+    scene_closest_hit(job->scene, ray, &hit);
+    return hit.hit ? job->shade(ray, &hit, job->scene, job->settings, path_seed, shadow_cache)
+                   : job->scene->background;
+}
+
+// Sum samples [first_sample, first_sample + count) of one pixel, jittered inside the pixel
+static Color trace_pixel_samples(TileJob *job, ShadowCache *shadow_cache, int x, int y, Uint32 seed, int first_sample, int count)
+{
+    int width = job->framebuffer->width;
+    int height = job->framebuffer->height;
+    Uint32 pixel_index = (Uint32)(y * width + x);
+    Color sum = color_create(0, 0, 0);
+
+    for (int sample = first_sample; sample < first_sample + count; sample++)
+    {
+        float jitter_x = random_float(seed, pixel_index, (Uint32)sample, 0);
+        float jitter_y = random_float(seed, pixel_index, (Uint32)sample, 1);
+        float u = ((float)x + jitter_x) / (float)width;
+        float v = ((float)(height - y) + jitter_y) / (float)height;
+
+        Ray ray = camera_get_ray(*job->camera, u, v);
+        sum = color_add(sum, trace_camera_ray(job, shadow_cache, ray, random_path_seed(seed, pixel_index, sample)));
+    }
+    return sum;
+}
+
+// Largest per-channel difference between a color and an already stored
+// pixel, both clamped and quantized to 8 bits as plain display would show them
+static float contrast_to_pixel(Color color, Color pixel)
+{
+    float dr = fabsf(fmaxf(0.0f, fminf(1.0f, color.r)) - (float)framebuffer_quantize(pixel.r) / 255.0f);
+    float dg = fabsf(fmaxf(0.0f, fminf(1.0f, color.g)) - (float)framebuffer_quantize(pixel.g) / 255.0f);
+    float db = fabsf(fmaxf(0.0f, fminf(1.0f, color.b)) - (float)framebuffer_quantize(pixel.b) / 255.0f);
+    return fmaxf(dr, fmaxf(dg, db));
+}
+
+// Adaptive anti-aliasing: trace a few samples, then spend the rest of the
+// budget only if they disagree with each other, or with the finished pixels
+// to the left and above, by more than the threshold in any channel.
+static Color trace_pixel_adaptive(TileJob *job, ShadowCache *shadow_cache, int x, int y, int x0, int y0, int *samples_used)
+{
+    RenderSettings *settings = job->settings;
+    int width = job->framebuffer->width;
+    int height = job->framebuffer->height;
+    Uint32 pixel_index = (Uint32)(y * width + x);
+    int initial = settings->adaptive_min_samples > 1 ? settings->adaptive_min_samples : 2;
+    if (initial > settings->samples_per_pixel)
+        initial = settings->samples_per_pixel;
+
+    Color sum = color_create(0, 0, 0);
+    Color low = color_create(INFINITY, INFINITY, INFINITY);
+    Color high = color_create(-INFINITY, -INFINITY, -INFINITY);
+
+    for (int sample = 0; sample < initial; sample++)
+    {
+        float jitter_x = random_float(job->frame_index, pixel_index, (Uint32)sample, 0);
+        float jitter_y = random_float(job->frame_index, pixel_index, (Uint32)sample, 1);
+        float u = ((float)x + jitter_x) / (float)width;
+        float v = ((float)(height - y) + jitter_y) / (float)height;
+
+        Color c = trace_camera_ray(job, shadow_cache, camera_get_ray(*job->camera, u, v),
+                                   random_path_seed(job->frame_index, pixel_index, sample));
+        sum = color_add(sum, c);
+        low = color_create(fminf(low.r, c.r), fminf(low.g, c.g), fminf(low.b, c.b));
+        high = color_create(fmaxf(high.r, c.r), fmaxf(high.g, c.g), fmaxf(high.b, c.b));
+    }
+
+    float contrast = fmaxf(high.r - low.r, fmaxf(high.g - low.g, high.b - low.b));
+    int count = initial;
+
+    // Both samples can land on the same side of a thin edge; neighbours inside
+    // this tile are already final, so compare against them too
+    Color mean = color_scale(sum, 1.0f / initial);
+    Color *pixels = job->framebuffer->hdr_pixels;
+    if (x > x0)
+        contrast = fmaxf(contrast, contrast_to_pixel(mean, pixels[pixel_index - 1]));
+    if (y > y0)
+        contrast = fmaxf(contrast, contrast_to_pixel(mean, pixels[pixel_index - (Uint32)width]));
+
+    if (contrast > settings->adaptive_threshold && initial < settings->samples_per_pixel)
+    {
+        int extra = settings->samples_per_pixel - initial;
+        sum = color_add(sum, trace_pixel_samples(job, shadow_cache, x, y, job->frame_index, initial, extra));
+        count += extra;
+    }
+
+    *samples_used = count;
+    return color_scale(sum, 1.0f / count);
+}
+
+// Tiles only write HDR colors; render_scene_advanced converts the whole
+// frame to 8 bits afterwards
+static void store_pixel(Framebuffer *framebuffer, int index, Color color)
+{
+    framebuffer->hdr_pixels[index] = color;
+}
+
+// One sample per pixel along a tile row. Primary rays are intersected as
+// 8x1 packets (or read back from the G-buffer); shading, shadows and
+// reflections then continue one ray at a time since they diverge quickly.
+static void render_row_packets(TileJob *job, ShadowCache *shadow_cache, int y, int x0, int x1)
+{
+    Framebuffer *framebuffer = job->framebuffer;
+    Scene *scene = job->scene;
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+    bool intersect = !job->gbuffer || job->gbuffer_fill;
+    float v = (float)(height - y) / (float)height;
+
+    for (int x = x0; x < x1; x += RAY_PACKET_SIZE)
+    {
+        Ray rays[RAY_PACKET_SIZE];
+        float distance[RAY_PACKET_SIZE];
+        int hit_index[RAY_PACKET_SIZE];
+        RayPacket packet;
+
+        ray_packet_clear(&packet);
+        packet.count = x1 - x < RAY_PACKET_SIZE ? x1 - x : RAY_PACKET_SIZE;
+        for (int lane = 0; lane < packet.count; lane++)
+        {
+            rays[lane] = camera_get_ray(*job->camera, (float)(x + lane) / (float)width, v);
+            ray_packet_set(&packet, lane, rays[lane]);
+        }
+
+        if (intersect)
+        {
+            RENDER_STATS_ADD(rays[RAY_CAMERA], packet.count);
+            scene_closest_hit_packet(scene, &packet, distance, hit_index);
+        }
+
+        for (int lane = 0; lane < packet.count; lane++)
+        {
+            int index = y * width + x + lane;
+            HitInfo hit;
+
+            if (intersect)
+            {
+                scene_resolve_hit(scene, rays[lane], hit_index[lane], distance[lane], &hit);
+                if (job->gbuffer)
+                {
+                    GBufferSample *sample = &job->gbuffer[index];
+                    sample->point = hit.point;
+                    sample->normal = hit.normal;
+                    sample->distance = hit.distance;
+                    sample->primitive = hit_index[lane];
+                }
+            }
+            else
+            {
+                // Camera and geometry unchanged: reuse the cached primary hit
+                GBufferSample *sample = &job->gbuffer[index];
+                hit.hit = sample->primitive >= 0;
+                if (hit.hit)
+                {
+                    hit.distance = sample->distance;
+                    hit.primitive = sample->primitive;
+                    hit.point = sample->point;
+                    hit.normal = sample->normal;
+                    hit.material = &scene->materials[scene->spheres[sample->primitive].material_id];
+                }
+            }
+
+            Color pixel_color = hit.hit ? job->shade(rays[lane], &hit, scene, job->settings,
+                                                     random_path_seed(job->frame_index, (Uint32)index, 0), shadow_cache)
+                                        : scene->background;
+            store_pixel(framebuffer, index, pixel_color);
+        }
+    }
+}
+
+// Trace a whole tile as one wavefront batch with the same samples and seeds
+// as the per-pixel paths below. Returns false (tracing nothing) when the
+// thread's queues cannot be allocated.
+static bool render_tile_wavefront(TileJob *job, ShadowCache *shadow_cache, int thread_index,
+                                  int x0, int y0, int x1, int y1, unsigned long long *samples)
+{
+    WavefrontQueues **queues = &job->wavefront_queues[thread_index];
+    if (!*queues)
+        *queues = wavefront_create();
+    if (!*queues)
+        return false;
+
+    WavefrontBatch batch;
+    batch.camera = job->camera;
+    batch.width = job->framebuffer->width;
+    batch.height = job->framebuffer->height;
+    batch.x0 = x0;
+    batch.y0 = y0;
+    batch.x1 = x1;
+    batch.y1 = y1;
+    batch.seed = job->frame_index;
+    batch.first_sample = 0;
+    batch.sample_count = 1;
+    batch.jitter = job->settings->enable_anti_aliasing;
+    if (job->accumulation)
+    {
+        batch.seed = 0;
+        batch.first_sample = job->accumulated_samples;
+        batch.sample_count = job->new_samples;
+    }
+    else if (job->settings->enable_anti_aliasing)
+    {
+        batch.sample_count = job->settings->samples_per_pixel;
+    }
+
+    Color *sums = NULL;
+    if (batch.sample_count > 0)
+    {
+        sums = wavefront_trace(*queues, &batch, job->scene, job->settings, shadow_cache);
+        if (!sums)
+            return false;
+    }
+
+    int width = job->framebuffer->width;
+    for (int y = y0; y < y1; y++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            int index = y * width + x;
+            Color sum = sums ? sums[(y - y0) * (x1 - x0) + (x - x0)] : color_create(0, 0, 0);
+            Color pixel_color;
+
+            if (job->accumulation)
+            {
+                job->accumulation[index] = color_add(job->accumulation[index], sum);
+                pixel_color = color_scale(job->accumulation[index],
+                                          1.0f / (job->accumulated_samples + job->new_samples));
+            }
+            else
+            {
+                pixel_color = color_scale(sum, 1.0f / batch.sample_count);
+            }
+            store_pixel(job->framebuffer, index, pixel_color);
+        }
+    }
+
+    *samples = (unsigned long long)((x1 - x0) * (y1 - y0) * batch.sample_count);
+    return true;
+}
+
+// Trace every pixel of one tile into the framebuffer
+static void render_tile(void *user_data, int tile_index, int thread_index)
+{
+    TileJob *job = (TileJob *)user_data;
+    Framebuffer *framebuffer = job->framebuffer;
+    RenderSettings *settings = job->settings;
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+
+    ShadowCache *shadow_cache = &job->shadow_caches[thread_index];
+    RENDER_STATS_BIND(&job->thread_stats[thread_index].stats);
+    Uint64 span = trace_span_begin();
+
+    int x0 = (tile_index % job->tiles_x) * job->tile_size;
+    int y0 = (tile_index / job->tiles_x) * job->tile_size;
+    int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+    int y1 = y0 + job->tile_size < height ? y0 + job->tile_size : height;
+    unsigned long long samples = 0;
+
+    // Adaptive sampling decides per pixel, so it stays on the recursive path
+    bool adaptive = !job->accumulation && settings->enable_anti_aliasing && settings->enable_adaptive_aa;
+    if (settings->enable_wavefront && !adaptive &&
+        render_tile_wavefront(job, shadow_cache, thread_index, x0, y0, x1, y1, &samples))
+    {
+        __atomic_fetch_add(&job->samples_traced, samples, __ATOMIC_RELAXED);
+        RENDER_STATS_BIND(NULL);
+        trace_span_end("tile", span, tile_index);
+        return;
+    }
+
+    for (int y = y0; y < y1; y++)
+    {
+        if (!job->accumulation && !settings->enable_anti_aliasing)
+        {
+            render_row_packets(job, shadow_cache, y, x0, x1);
+            samples += (unsigned long long)(x1 - x0);
+            continue;
+        }
+
+        for (int x = x0; x < x1; x++)
+        {
+            int index = y * width + x;
+            Color pixel_color;
+
+            if (job->accumulation)
+            {
+                // Progressive anti-aliasing: add this frame's samples to the running sum
+                if (job->new_samples > 0)
+                {
+                    Color sum = trace_pixel_samples(job, shadow_cache, x, y, 0, job->accumulated_samples, job->new_samples);
+                    job->accumulation[index] = color_add(job->accumulation[index], sum);
+                    samples += (unsigned long long)job->new_samples;
+                }
+                pixel_color = color_scale(job->accumulation[index],
+                                          1.0f / (job->accumulated_samples + job->new_samples));
+            }
+            else if (settings->enable_anti_aliasing && settings->enable_adaptive_aa)
+            {
+                int used;
+                pixel_color = trace_pixel_adaptive(job, shadow_cache, x, y, x0, y0, &used);
+                samples += (unsigned long long)used;
+            }
+            else
+            {
+                // Multi-sampling for anti-aliasing
+                pixel_color = trace_pixel_samples(job, shadow_cache, x, y, job->frame_index, 0, settings->samples_per_pixel);
+                pixel_color = color_scale(pixel_color, 1.0f / settings->samples_per_pixel);
+                samples += (unsigned long long)settings->samples_per_pixel;
+            }
+
+            store_pixel(framebuffer, index, pixel_color);
+        }
+    }
+
+    __atomic_fetch_add(&job->samples_traced, samples, __ATOMIC_RELAXED);
+    RENDER_STATS_BIND(NULL);
+    trace_span_end("tile", span, tile_index);
+}
+
+// Settings that change the traced samples; tone mapping and the stats
+// overlay only post-process them, so they keep the accumulated image
+static bool tracing_settings_equal(const RenderSettings *a, const RenderSettings *b)
+{
+    return a->enable_shadows == b->enable_shadows &&
+           a->enable_reflections == b->enable_reflections &&
+           a->enable_anti_aliasing == b->enable_anti_aliasing &&
+           a->samples_per_pixel == b->samples_per_pixel &&
+           a->reflection_strength == b->reflection_strength &&
+           a->enable_progressive == b->enable_progressive &&
+           a->progressive_samples_per_frame == b->progressive_samples_per_frame &&
+           a->progressive_max_samples == b->progressive_max_samples &&
+           a->enable_adaptive_aa == b->enable_adaptive_aa &&
+           a->adaptive_min_samples == b->adaptive_min_samples &&
+           a->adaptive_threshold == b->adaptive_threshold &&
+           a->enable_gbuffer == b->enable_gbuffer &&
+           a->max_depth == b->max_depth &&
+           a->roulette_threshold == b->roulette_threshold &&
+           a->enable_wavefront == b->enable_wavefront &&
+           a->enable_ray_sorting == b->enable_ray_sorting;
+}
+
+// Every setting, compared field by field so padding bytes never count
+bool render_settings_equal(const RenderSettings *a, const RenderSettings *b)
+{
+    return tracing_settings_equal(a, b) &&
+           a->tone_map.exposure == b->tone_map.exposure &&
+           a->tone_map.curve == b->tone_map.curve &&
+           a->tone_map.srgb == b->tone_map.srgb &&
+           a->tone_map.dither == b->tone_map.dither &&
+           a->show_stats == b->show_stats;
+}
+
+// Compare this frame's inputs with the previous frame's and remember them.
+// Sets *view_changed when primary hits may differ (camera, geometry, size) and
+// *shading_changed when only the lighting or render settings differ.
+static void detect_changes(RenderContext *context, Framebuffer *framebuffer, Scene *scene,
+                           Camera *camera, RenderSettings *settings,
+                           bool *view_changed, bool *shading_changed)
+{
+    RenderSnapshot *last = &context->last_frame;
+
+    *view_changed = !last->valid ||
+                    last->scene != scene ||
+                    last->scene_version != scene->version ||
+                    last->width != framebuffer->width ||
+                    last->height != framebuffer->height ||
+                    !camera_equal(&last->camera, camera);
+
+    *shading_changed = !last->valid ||
+                       !tracing_settings_equal(&last->settings, settings) ||
+                       last->light_count != scene->light_count ||
+                       memcmp(last->lights, scene->lights, sizeof(Light) * scene->light_count) != 0 ||
+                       memcmp(&last->background, &scene->background, sizeof(Color)) != 0;
+
+    last->valid = true;
+    last->scene = scene;
+    last->scene_version = scene->version;
+    last->width = framebuffer->width;
+    last->height = framebuffer->height;
+    last->camera = *camera;
+    last->settings = *settings;
+    last->light_count = scene->light_count;
+    memcpy(last->lights, scene->lights, sizeof(Light) * scene->light_count);
+    last->background = scene->background;
+}
+
+// Make sure the accumulation buffer covers the framebuffer, clearing it on reset
+static bool prepare_accumulation(RenderContext *context, Framebuffer *framebuffer, bool reset)
+{
+    int pixel_count = framebuffer->width * framebuffer->height;
+
+    if (context->accumulation_size != pixel_count)
+    {
+        free(context->accumulation);
+        context->accumulation = (Color *)malloc(sizeof(Color) * (size_t)pixel_count);
+        context->accumulation_size = context->accumulation ? pixel_count : 0;
+        reset = true;
+    }
+
+    if (!context->accumulation)
+        return false;
+
+    if (reset)
+    {
+        memset(context->accumulation, 0, sizeof(Color) * (size_t)pixel_count);
+        context->accumulated_samples = 0;
+    }
+    return true;
+}
+
+// Make sure the G-buffer covers the framebuffer; a new buffer starts invalid
+static bool prepare_gbuffer(RenderContext *context, Framebuffer *framebuffer)
+{
+    int pixel_count = framebuffer->width * framebuffer->height;
+
+    if (context->gbuffer_size != pixel_count)
+    {
+        free(context->gbuffer);
+        context->gbuffer = (GBufferSample *)malloc(sizeof(GBufferSample) * (size_t)pixel_count);
+        context->gbuffer_size = context->gbuffer ? pixel_count : 0;
+        context->gbuffer_valid = false;
+    }
+    return context->gbuffer != NULL;
+}
+
+// Rows per tone mapping task, enough to amortize the task dispatch
+#define TONEMAP_BAND_ROWS 16
+
+typedef struct
+{
+    Framebuffer *framebuffer;
+    const ToneMapSettings *settings;
+} TonemapJob;
+
+static void tonemap_band(void *user_data, int band_index, int thread_index)
+{
+    TonemapJob *job = (TonemapJob *)user_data;
+    (void)thread_index;
+    Uint64 span = trace_span_begin();
+    framebuffer_tonemap(job->framebuffer, job->settings, band_index * TONEMAP_BAND_ROWS, TONEMAP_BAND_ROWS);
+    trace_span_end("tonemap band", span, band_index);
+}
+
+// Advanced rendering with all features, split into tiles across the thread pool
+void render_scene_advanced(RenderContext *context, Framebuffer *framebuffer, Scene *scene,
+                           Camera *camera, RenderSettings *settings)
+{
+    double start_time = timer_seconds();
+
+    if (!framebuffer_enable_hdr(framebuffer))
+    {
+        fprintf(stderr, "Failed to allocate the HDR framebuffer\n");
+        return;
+    }
+
+    Uint64 frame_span = trace_span_begin();
+    Uint64 span = trace_span_begin();
+    scene_update_bvh(scene); // no-op unless spheres were added
+    trace_span_end("bvh update", span, -1);
+
+    TileJob job;
+    job.framebuffer = framebuffer;
+    job.scene = scene;
+    job.camera = camera;
+    job.settings = settings;
+    job.shade = shade_kernel_select(settings);
+    job.tile_size = context->tile_size;
+    job.frame_index = context->frame_index++;
+    job.tiles_x = (framebuffer->width + job.tile_size - 1) / job.tile_size;
+    int tiles_y = (framebuffer->height + job.tile_size - 1) / job.tile_size;
+    job.accumulation = NULL;
+    job.accumulated_samples = 0;
+    job.new_samples = 0;
+    job.samples_traced = 0;
+    job.gbuffer = NULL;
+    job.shadow_caches = context->shadow_caches;
+    job.wavefront_queues = context->wavefront_queues;
+    job.thread_stats = context->thread_stats;
+    job.gbuffer_fill = false;
+
+    bool view_changed, shading_changed;
+    detect_changes(context, framebuffer, scene, camera, settings, &view_changed, &shading_changed);
+
+    // While nothing changes, keep adding a few samples per pixel to the running average
+    if (settings->enable_anti_aliasing && settings->enable_progressive &&
+        prepare_accumulation(context, framebuffer, view_changed || shading_changed))
+    {
+        int remaining = settings->progressive_max_samples - context->accumulated_samples;
+        int per_frame = settings->progressive_samples_per_frame > 0 ? settings->progressive_samples_per_frame : 1;
+
+        job.accumulation = context->accumulation;
+        job.accumulated_samples = context->accumulated_samples;
+        job.new_samples = remaining < per_frame ? (remaining > 0 ? remaining : 0) : per_frame;
+        if (job.accumulated_samples + job.new_samples == 0)
+            job.new_samples = 1;
+        context->accumulated_samples += job.new_samples;
+    }
+
+    // Primary hits only depend on the camera and geometry, so when just the
+    // lights or settings change the cached hits are shaded again as they are
+    if (view_changed)
+        context->gbuffer_valid = false;
+
+    if (settings->enable_gbuffer && !settings->enable_anti_aliasing && !settings->enable_wavefront &&
+        prepare_gbuffer(context, framebuffer))
+    {
+        job.gbuffer = context->gbuffer;
+        job.gbuffer_fill = !context->gbuffer_valid;
+        context->gbuffer_valid = true;
+    }
+
+    span = trace_span_begin();
+    thread_pool_run(context->thread_pool, job.tiles_x * tiles_y, render_tile, &job);
+    trace_span_end("trace tiles", span, -1);
+    context->samples_traced = job.samples_traced;
+    render_stats_merge(&context->stats, context->thread_stats, thread_pool_size(context->thread_pool));
+
+    // Convert the finished frame in one vectorized pass instead of per pixel while tracing
+    span = trace_span_begin();
+    TonemapJob tonemap = {framebuffer, &settings->tone_map};
+    thread_pool_run(context->thread_pool, (framebuffer->height + TONEMAP_BAND_ROWS - 1) / TONEMAP_BAND_ROWS,
+                    tonemap_band, &tonemap);
+    trace_span_end("tonemap", span, -1);
+    if (settings->show_stats)
+        render_stats_draw(framebuffer, &context->stats);
+    trace_span_end("frame", frame_span, (int)job.frame_index);
+
+    frame_stats_add(&context->frame_stats, timer_seconds() - start_time);
+}
@@ -1,5 +1,8 @@
 #include "raytracing.h"
 #include <stdlib.h>
+#include <string.h>
+
+#define MATERIAL_REUSE_WINDOW 16 // recent materials scene_add_sphere compares against
 
 // Scene management
 Scene *scene_create(void)
@@ -8,9 +11,18 @@ Scene *scene_create(void)
     if (!scene)
         return NULL;
 
+    scene->spheres = NULL;
     scene->sphere_count = 0;
+    scene->sphere_capacity = 0;
+    scene->materials = NULL;
+    scene->material_count = 0;
+    scene->material_capacity = 0;
+    memset(&scene->bvh, 0, sizeof(Bvh));
+    scene->bvh_dirty = false;
     scene->light_count = 0;
+    scene->version = 0;
     scene->background = color_create(0.1f, 0.1f, 0.2f); // Dark blue background
+    intersect_init();
 
     return scene;
 }
@@ -19,41 +31,118 @@ void scene_destroy(Scene *scene)
 {
     if (scene)
     {
+        bvh_free(&scene->bvh);
+        free(scene->spheres);
+        free(scene->materials);
         free(scene);
     }
 }
 
+// Append a material to the table; returns its id, or -1 if the table cannot grow
+int scene_add_material(Scene *scene, Material material)
+{
+    if (!scene)
+        return -1;
+
+    if (scene->material_count == scene->material_capacity)
+    {
+        int capacity = scene->material_capacity ? scene->material_capacity * 2 : 16;
+        Material *materials = (Material *)realloc(scene->materials, sizeof(Material) * (size_t)capacity);
+        if (!materials)
+        {
+            fprintf(stderr, "Failed to grow scene to %d materials\n", capacity);
+            return -1;
+        }
+        scene->materials = materials;
+        scene->material_capacity = capacity;
+    }
+
+    scene->materials[scene->material_count] = material;
+    scene->version++;
+    return scene->material_count++;
+}
+
+// Add a sphere with its own copy of a material. Spheres sharing a material
+// are usually added together, so the most recent materials are checked
+// first and an identical one is reused instead of stored again.
 void scene_add_sphere(Scene *scene, Vector3 center, float radius, Material material)
 {
-    if (scene && scene->sphere_count < MAX_SPHERES)
+    if (!scene)
+        return;
+
+    int material_id = -1;
+    int oldest = scene->material_count > MATERIAL_REUSE_WINDOW ? scene->material_count - MATERIAL_REUSE_WINDOW : 0;
+    for (int i = scene->material_count - 1; i >= oldest && material_id < 0; i--)
+    {
+        if (memcmp(&scene->materials[i], &material, sizeof(Material)) == 0)
+            material_id = i;
+    }
+    if (material_id < 0)
+        material_id = scene_add_material(scene, material);
+    if (material_id >= 0)
+        scene_add_sphere_with_material(scene, center, radius, material_id);
+}
+
+void scene_add_sphere_with_material(Scene *scene, Vector3 center, float radius, int material_id)
+{
+    if (!scene || material_id < 0 || material_id >= scene->material_count)
+        return;
+
+    if (scene->sphere_count == scene->sphere_capacity)
     {
-        scene->spheres[scene->sphere_count].center = center;
-        scene->spheres[scene->sphere_count].radius = radius;
-        scene->spheres[scene->sphere_count].material = material;
-        scene->sphere_count++;
+        int capacity = scene->sphere_capacity ? scene->sphere_capacity * 2 : 16;
+        Sphere *spheres = (Sphere *)realloc(scene->spheres, sizeof(Sphere) * (size_t)capacity);
+        if (!spheres)
+        {
+            fprintf(stderr, "Failed to grow scene to %d spheres\n", capacity);
+            return;
+        }
+        scene->spheres = spheres;
+        scene->sphere_capacity = capacity;
     }
+
+    scene->spheres[scene->sphere_count].center = center;
+    scene->spheres[scene->sphere_count].radius = radius;
+    scene->spheres[scene->sphere_count].material_id = material_id;
+    scene->sphere_count++;
+    scene->bvh_dirty = true;
+    scene->version++;
+}
+
+// Rebuild the BVH if spheres were added since the last build. Call before
+// tracing; until then intersections fall back to testing every sphere.
+bool scene_update_bvh(Scene *scene)
+{
+    if (!scene->bvh_dirty)
+        return true;
+
+    if (!bvh_build(&scene->bvh, scene->spheres, scene->sphere_count))
+        return false;
+    scene->bvh_dirty = false;
+    return true;
 }
 
 void scene_add_light(Scene *scene, Vector3 position, Color color, float intensity)
 {
-    if (scene && scene->light_count < 5)
+    if (scene && scene->light_count < MAX_LIGHTS)
     {
         scene->lights[scene->light_count].position = position;
         scene->lights[scene->light_count].color = color;
         scene->lights[scene->light_count].intensity = intensity;
         scene->light_count++;
+        scene->version++;
     }
 }
 
-// Ray creation for camera
-Ray create_camera_ray(int x, int y, Vector3 camera_pos)
+// Ray creation for camera; the width x height image spans NDC -1..1 at any size
+Ray create_camera_ray(int x, int y, int width, int height, Vector3 camera_pos)
 {
     Ray ray;
     ray.origin = camera_pos;
 
     // Convert screen coordinates to normalized device coordinates
-    float ndc_x = (2.0f * x / WINDOW_WIDTH) - 1.0f;
-    float ndc_y = 1.0f - (2.0f * y / WINDOW_HEIGHT);
+    float ndc_x = (2.0f * x / width) - 1.0f;
+    float ndc_y = 1.0f - (2.0f * y / height);
 
     // Simple perspective projection
     ray.direction = vector3_normalize(vector3_create(ndc_x, ndc_y, -1.0f));
@@ -73,6 +162,16 @@ Camera camera_create(Vector3 position, Vector3 target, Vector3 up, float fov)
     return camera;
 }
 
+// Field by field, so padding never makes equal cameras differ
+bool camera_equal(const Camera *a, const Camera *b)
+{
+    return vector3_equal(a->position, b->position) &&
+           vector3_equal(a->target, b->target) &&
+           vector3_equal(a->up, b->up) &&
+           a->fov == b->fov &&
+           a->aspect_ratio == b->aspect_ratio;
+}
+
 Ray camera_get_ray(Camera camera, float u, float v)
 {
     // Calculate camera coordinate system
@@ -96,37 +195,25 @@ Ray camera_get_ray(Camera camera, float u, float v)
 }
 
 // Main rendering function with proper raytracing
-void render_scene(SDL_Renderer *renderer, Scene *scene, Vector3 camera_pos)
+void render_scene(Framebuffer *framebuffer, Scene *scene, Vector3 camera_pos)
 {
-    for (int y = 0; y < WINDOW_HEIGHT; y++)
+    scene_update_bvh(scene);
+
+    for (int y = 0; y < framebuffer->height; y++)
     {
-        for (int x = 0; x < WINDOW_WIDTH; x++)
+        for (int x = 0; x < framebuffer->width; x++)
         {
-            Ray ray = create_camera_ray(x, y, camera_pos);
+            Ray ray = create_camera_ray(x, y, framebuffer->width, framebuffer->height, camera_pos);
 
             HitInfo closest_hit;
-            closest_hit.hit = false;
-            closest_hit.distance = INFINITY;
-
-            // Test intersection with all spheres
-            for (int i = 0; i < scene->sphere_count; i++)
-            {
-                HitInfo hit;
-                if (sphere_intersect(scene->spheres[i], ray, &hit))
-                {
-                    if (hit.distance < closest_hit.distance)
-                    {
-                        closest_hit = hit;
-                    }
-                }
-            }
+            scene_closest_hit(scene, ray, &closest_hit);
 
             Color pixel_color;
             if (closest_hit.hit)
             {
                 Vector3 view_dir = vector3_normalize(vector3_sub(camera_pos, closest_hit.point));
                 pixel_color = calculate_lighting(closest_hit.point, closest_hit.normal,
-                                                 view_dir, closest_hit.material,
+                                                 view_dir, *closest_hit.material,
                                                  scene->lights, scene->light_count);
             }
             else
@@ -134,78 +221,99 @@ void render_scene(SDL_Renderer *renderer, Scene *scene, Vector3 camera_pos)
                 pixel_color = scene->background;
             }
 
-            // Convert color to RGB and draw pixel
-            Uint8 r = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.r)) * 255);
-            Uint8 g = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.g)) * 255);
-            Uint8 b = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.b)) * 255);
-
-            SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-            SDL_RenderDrawPoint(renderer, x, y);
+            // Convert color to RGBA8 and store pixel
+            framebuffer->pixels[y * framebuffer->width + x] = framebuffer_pack_color(pixel_color);
         }
     }
 }
 
-// Advanced rendering with all features
-void render_scene_advanced(SDL_Renderer *renderer, Scene *scene, Camera *camera, RenderSettings *settings)
+// Scene description files. One entry per line, '#' starts a comment:
+//   background r g b
+//   camera px py pz  tx ty tz  ux uy uz  fov
+//   sphere cx cy cz radius  r g b  ambient diffuse specular shininess
+//   light px py pz  r g b  intensity
+Scene *scene_load(const char *path, Camera *camera)
 {
-    static int frame_count = 0;
-    static Uint32 start_time = 0;
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open scene file %s\n", path);
+        return NULL;
+    }
 
-    if (frame_count == 0)
+    Scene *scene = scene_create();
+    if (!scene)
     {
-        start_time = SDL_GetTicks();
+        fclose(file);
+        return NULL;
     }
 
-    for (int y = 0; y < WINDOW_HEIGHT; y++)
+    char line[512];
+    int line_number = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), file))
     {
-        for (int x = 0; x < WINDOW_WIDTH; x++)
-        {
-            Color pixel_color = color_create(0, 0, 0);
+        line_number++;
 
-            if (settings->enable_anti_aliasing)
-            {
-                // Multi-sampling for anti-aliasing
-                for (int sample = 0; sample < settings->samples_per_pixel; sample++)
-                {
-                    float u = ((float)x + ((float)rand() / RAND_MAX)) / (float)WINDOW_WIDTH;
-                    float v = ((float)(WINDOW_HEIGHT - y) + ((float)rand() / RAND_MAX)) / (float)WINDOW_HEIGHT;
-
-                    Ray ray = camera_get_ray(*camera, u, v);
-                    Color sample_color = trace_ray(ray, scene, settings, 0);
-                    pixel_color = color_add(pixel_color, sample_color);
-                }
-                pixel_color = color_scale(pixel_color, 1.0f / settings->samples_per_pixel);
-            }
-            else
-            {
-                float u = (float)x / (float)WINDOW_WIDTH;
-                float v = (float)(WINDOW_HEIGHT - y) / (float)WINDOW_HEIGHT;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
 
-                Ray ray = camera_get_ray(*camera, u, v);
-                pixel_color = trace_ray(ray, scene, settings, 0);
-            }
+        char keyword[32];
+        int offset = 0;
+        if (sscanf(line, " %31s%n", keyword, &offset) != 1)
+            continue; // blank line
 
-            // Convert color to RGB and draw pixel
-            Uint8 r = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.r)) * 255);
-            Uint8 g = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.g)) * 255);
-            Uint8 b = (Uint8)(fmaxf(0.0f, fminf(1.0f, pixel_color.b)) * 255);
+        const char *args = line + offset;
+        float v[13];
+
+        if (strcmp(keyword, "background") == 0)
+        {
+            ok = sscanf(args, "%f %f %f", &v[0], &v[1], &v[2]) == 3;
+            if (ok)
+                scene->background = color_create(v[0], v[1], v[2]);
+        }
+        else if (strcmp(keyword, "camera") == 0)
+        {
+            ok = sscanf(args, "%f %f %f %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4],
+                        &v[5], &v[6], &v[7], &v[8], &v[9]) == 10;
+            if (ok && camera)
+                *camera = camera_create(vector3_create(v[0], v[1], v[2]), vector3_create(v[3], v[4], v[5]),
+                                        vector3_create(v[6], v[7], v[8]), v[9]);
+        }
+        else if (strcmp(keyword, "sphere") == 0)
+        {
+            ok = sscanf(args, "%f %f %f %f %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4],
+                        &v[5], &v[6], &v[7], &v[8], &v[9], &v[10]) == 11;
+            if (ok)
+            {
+                Material material = {color_create(v[4], v[5], v[6]), v[7], v[8], v[9], v[10]};
+                scene_add_sphere(scene, vector3_create(v[0], v[1], v[2]), v[3], material);
+            }
+        }
+        else if (strcmp(keyword, "light") == 0)
+        {
+            ok = sscanf(args, "%f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) == 7;
+            if (ok)
+                scene_add_light(scene, vector3_create(v[0], v[1], v[2]), color_create(v[3], v[4], v[5]), v[6]);
+        }
+        else
+        {
+            ok = false;
+        }
 
-            SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-            SDL_RenderDrawPoint(renderer, x, y);
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%d: invalid '%s' entry\n", path, line_number, keyword);
         }
     }
 
-    frame_count++;
-    if (frame_count % 60 == 0)
+    fclose(file);
+    if (!ok)
     {
-        float elapsed = (SDL_GetTicks() - start_time) / 1000.0f;
-        print_performance_stats(frame_count, elapsed);
+        scene_destroy(scene);
+        return NULL;
     }
+    return scene;
 }
-
-// Performance monitoring
-void print_performance_stats(int frame_count, float total_time)
-{
-    float fps = frame_count / total_time;
-    printf("Performance: %d frames in %.2fs (%.1f FPS)\n", frame_count, total_time, fps);
-}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "raytracing.h"
+#include <string.h>
+
+// Seeded procedural scenes for scaling measurements. Every position, radius
+// and material choice is a pure function of (seed, index), like the sample
+// jitter in random.c, so a (kind, count, seed) triple always yields the same
+// scene. Sizes scale with the sphere count so density stays roughly constant
+// and the generated camera frames the whole scene.
+
+#define GENERATOR_PALETTE_SIZE 16
+
+// Random streams, so spheres, clusters and lights draw independent numbers
+enum
+{
+    STREAM_SPHERE,
+    STREAM_CLUSTER,
+    STREAM_LIGHT,
+    STREAM_PALETTE
+};
+
+static const char *kind_names[SCENE_KIND_COUNT] = {"field", "clusters", "lights", "corridor"};
+
+const char *scene_kind_name(SceneKind kind)
+{
+    return kind >= 0 && kind < SCENE_KIND_COUNT ? kind_names[kind] : "unknown";
+}
+
+bool scene_kind_parse(const char *name, SceneKind *kind)
+{
+    for (int i = 0; i < SCENE_KIND_COUNT; i++)
+    {
+        if (strcmp(name, kind_names[i]) == 0)
+        {
+            *kind = (SceneKind)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static float gen_float(Uint32 seed, Uint32 stream, Uint32 index, Uint32 dimension)
+{
+    return random_float(seed, index, stream, dimension);
+}
+
+// Uniform in [low, high)
+static float gen_range(Uint32 seed, Uint32 stream, Uint32 index, Uint32 dimension, float low, float high)
+{
+    return low + (high - low) * gen_float(seed, stream, index, dimension);
+}
+
+// Random materials shared by all spheres; mirror-like when mirrors is set.
+// Returns the id of the first one, or -1 if the table cannot grow.
+static int add_palette(Scene *scene, Uint32 seed, bool mirrors)
+{
+    int first = -1;
+    for (Uint32 i = 0; i < GENERATOR_PALETTE_SIZE; i++)
+    {
+        Material material;
+        material.color = color_create(gen_range(seed, STREAM_PALETTE, i, 0, 0.2f, 0.9f),
+                                      gen_range(seed, STREAM_PALETTE, i, 1, 0.2f, 0.9f),
+                                      gen_range(seed, STREAM_PALETTE, i, 2, 0.2f, 0.9f));
+        material.ambient = 0.1f;
+        material.diffuse = mirrors ? 0.3f : gen_range(seed, STREAM_PALETTE, i, 3, 0.5f, 0.9f);
+        material.specular = mirrors ? gen_range(seed, STREAM_PALETTE, i, 4, 0.85f, 1.0f)
+                                    : gen_range(seed, STREAM_PALETTE, i, 4, 0.0f, 0.9f);
+        material.shininess = mirrors ? 256.0f : 8.0f + 248.0f * gen_float(seed, STREAM_PALETTE, i, 5);
+
+        int id = scene_add_material(scene, material);
+        if (id < 0)
+            return -1;
+        if (first < 0)
+            first = id;
+    }
+    return first;
+}
+
+static int palette_entry(int first, Uint32 seed, Uint32 index)
+{
+    return first + (int)(random_hash4(seed, index, STREAM_PALETTE, 6) % GENERATOR_PALETTE_SIZE);
+}
+
+// Spheres scattered uniformly through a box of side about 3 * cbrt(count)
+static float generate_field(Scene *scene, int count, Uint32 seed, int palette)
+{
+    float side = 3.0f * cbrtf((float)count);
+    for (int i = 0; i < count; i++)
+    {
+        Uint32 index = (Uint32)i;
+        Vector3 center = vector3_create(gen_range(seed, STREAM_SPHERE, index, 0, -0.5f, 0.5f) * side,
+                                        gen_range(seed, STREAM_SPHERE, index, 1, -0.5f, 0.5f) * side,
+                                        gen_range(seed, STREAM_SPHERE, index, 2, -0.5f, 0.5f) * side);
+        float radius = gen_range(seed, STREAM_SPHERE, index, 3, 0.2f, 0.6f);
+        scene_add_sphere_with_material(scene, center, radius, palette_entry(palette, seed, index));
+    }
+    return side;
+}
+
+// Small spheres packed around a few cluster centers, leaving most of the
+// box empty: the uneven case for a BVH
+static float generate_clusters(Scene *scene, int count, Uint32 seed, int palette)
+{
+    int cluster_count = 1 + count / 2000;
+    if (cluster_count > 64)
+        cluster_count = 64;
+    float side = 3.0f * cbrtf((float)count);
+    float spread = 0.25f * cbrtf((float)count / cluster_count);
+
+    for (int i = 0; i < count; i++)
+    {
+        Uint32 index = (Uint32)i;
+        Uint32 cluster = random_hash4(seed, index, STREAM_CLUSTER, 0) % (Uint32)cluster_count;
+        Vector3 origin = vector3_create(gen_range(seed, STREAM_CLUSTER, cluster, 1, -0.4f, 0.4f) * side,
+                                        gen_range(seed, STREAM_CLUSTER, cluster, 2, -0.4f, 0.4f) * side,
+                                        gen_range(seed, STREAM_CLUSTER, cluster, 3, -0.4f, 0.4f) * side);
+
+        // The sum of three uniforms concentrates spheres near the center
+        Vector3 offset = vector3_create(0, 0, 0);
+        for (Uint32 k = 0; k < 3; k++)
+        {
+            offset = vector3_add(offset, vector3_create(gen_range(seed, STREAM_SPHERE, index, 3 * k, -1.0f, 1.0f),
+                                                        gen_range(seed, STREAM_SPHERE, index, 3 * k + 1, -1.0f, 1.0f),
+                                                        gen_range(seed, STREAM_SPHERE, index, 3 * k + 2, -1.0f, 1.0f)));
+        }
+        float radius = gen_range(seed, STREAM_SPHERE, index, 9, 0.1f, 0.3f);
+        scene_add_sphere_with_material(scene, vector3_add(origin, vector3_scale(offset, spread)), radius,
+                                       palette_entry(palette, seed, index));
+    }
+    return side;
+}
+
+// Mirror spheres lining the walls and floor of a corridor along -z; the
+// camera looks down it, so most primary rays bounce several times
+static float generate_corridor(Scene *scene, int count, Uint32 seed, int palette, Camera *camera)
+{
+    int rows = (int)sqrtf((float)count / 24.0f); // spheres across a wall
+    if (rows < 1)
+        rows = 1;
+    float half_width = 0.5f * rows + 1.0f;
+    int columns = (count + 3 * rows - 1) / (3 * rows);
+
+    for (int i = 0; i < count; i++)
+    {
+        int wall = i % 3;
+        int row = (i / 3) % rows;
+        int column = (i / 3) / rows;
+        float across = -half_width + 0.5f + (float)row + 0.5f * (column & 1);
+        float z = -2.0f - (float)column;
+        Vector3 center = wall == 0   ? vector3_create(-half_width, across, z)
+                         : wall == 1 ? vector3_create(half_width, across, z)
+                                     : vector3_create(across, -half_width, z);
+        scene_add_sphere_with_material(scene, center, 0.5f, palette_entry(palette, seed, (Uint32)i));
+    }
+
+    if (camera)
+    {
+        *camera = camera_create(vector3_create(0.0f, 0.0f, 0.0f), vector3_create(0.0f, 0.0f, -1.0f),
+                                vector3_create(0.0f, 1.0f, 0.0f), 60.0f);
+    }
+    return 2.0f + (float)columns;
+}
+
+// Build a procedural scene of the given kind. light_count <= 0 picks the
+// kind's default (MAX_LIGHTS for SCENE_MANY_LIGHTS, 2 otherwise). When camera
+// is not NULL it is pointed at the scene.
+Scene *scene_generate(SceneKind kind, int sphere_count, int light_count, Uint32 seed, Camera *camera)
+{
+    if (sphere_count < 1 || kind < 0 || kind >= SCENE_KIND_COUNT)
+        return NULL;
+
+    Scene *scene = scene_create();
+    if (!scene)
+        return NULL;
+
+    int palette = add_palette(scene, seed, kind == SCENE_CORRIDOR);
+    if (palette < 0)
+    {
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    float extent;
+    switch (kind)
+    {
+    case SCENE_CLUSTERS:
+        extent = generate_clusters(scene, sphere_count, seed, palette);
+        break;
+    case SCENE_CORRIDOR:
+        extent = generate_corridor(scene, sphere_count, seed, palette, camera);
+        break;
+    default:
+        extent = generate_field(scene, sphere_count, seed, palette);
+        break;
+    }
+
+    if (scene->sphere_count != sphere_count)
+    {
+        scene_destroy(scene); // ran out of memory part way
+        return NULL;
+    }
+
+    if (light_count <= 0)
+        light_count = kind == SCENE_MANY_LIGHTS ? MAX_LIGHTS : 2;
+    if (light_count > MAX_LIGHTS)
+        light_count = MAX_LIGHTS;
+
+    // Lights on a ring in front of the scene (inside the corridor for
+    // SCENE_CORRIDOR), sharing a fixed total intensity
+    for (int i = 0; i < light_count; i++)
+    {
+        Uint32 index = (Uint32)i;
+        float angle = 2.0f * (float)M_PI * ((float)i + gen_float(seed, STREAM_LIGHT, index, 0)) / light_count;
+        Vector3 position;
+        if (kind == SCENE_CORRIDOR)
+            position = vector3_create(0.5f * cosf(angle), 0.5f * sinf(angle), -2.0f - extent * (i + 0.5f) / light_count);
+        else
+            position = vector3_create(0.6f * extent * cosf(angle), 0.6f * extent * sinf(angle), 0.75f * extent);
+        Color color = color_create(gen_range(seed, STREAM_LIGHT, index, 1, 0.6f, 1.0f),
+                                   gen_range(seed, STREAM_LIGHT, index, 2, 0.6f, 1.0f),
+                                   gen_range(seed, STREAM_LIGHT, index, 3, 0.6f, 1.0f));
+        scene_add_light(scene, position, color, 1.5f / sqrtf((float)light_count));
+    }
+
+    // Far enough back that a 45 degree view covers the whole box
+    if (camera && kind != SCENE_CORRIDOR)
+    {
+        *camera = camera_create(vector3_create(0.0f, 0.2f * extent, 1.3f * extent),
+                                vector3_create(0.0f, 0.0f, 0.0f), vector3_create(0.0f, 1.0f, 0.0f), 45.0f);
+    }
+    return scene;
+}
@@ -0,0 +1,290 @@
+#define _POSIX_C_SOURCE 200809L
+#include "raytracing.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Per-worker task deque. The owner pops from the front so it walks its own
+// block of tiles in order; thieves take from the back of someone else's block.
+typedef struct
+{
+    pthread_mutex_t lock;
+    int *tasks;
+    int capacity;
+    int head;
+    int tail;
+} TaskDeque;
+
+typedef struct
+{
+    ThreadPool *pool;
+    int index;
+} WorkerInfo;
+
+struct ThreadPool
+{
+    int thread_count;
+    int deque_count;
+    pthread_t *threads;
+    WorkerInfo *workers;
+    TaskDeque *deques;
+
+    // Current job, published under lock
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned int generation;
+    int workers_finished;
+    int tasks_remaining;
+    bool shutdown;
+    ThreadPoolTask task;
+    void *user_data;
+};
+
+static bool deque_pop(TaskDeque *deque, int *task_index)
+{
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail)
+    {
+        *task_index = deque->tasks[deque->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal(TaskDeque *deque, int *task_index)
+{
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail)
+    {
+        *task_index = deque->tasks[--deque->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Drain own deque, then steal until every deque is empty
+static void worker_run_tasks(ThreadPool *pool, int worker_index, ThreadPoolTask task, void *user_data)
+{
+    int finished = 0;
+    int task_index;
+
+    for (;;)
+    {
+        bool found = deque_pop(&pool->deques[worker_index], &task_index);
+
+        for (int i = 1; !found && i < pool->thread_count; i++)
+        {
+            int victim = (worker_index + i) % pool->thread_count;
+            found = deque_steal(&pool->deques[victim], &task_index);
+        }
+
+        if (!found)
+            break;
+
+        task(user_data, task_index, worker_index);
+        finished++;
+    }
+
+    if (finished > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->tasks_remaining -= finished;
+        if (pool->tasks_remaining == 0)
+            pthread_cond_broadcast(&pool->work_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerInfo *info = (WorkerInfo *)arg;
+    ThreadPool *pool = info->pool;
+    unsigned int seen_generation = 0;
+
+    trace_set_thread_name("worker", info->index);
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->shutdown && pool->generation == seen_generation)
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+
+        if (pool->shutdown)
+            break;
+
+        seen_generation = pool->generation;
+        ThreadPoolTask task = pool->task;
+        void *user_data = pool->user_data;
+        pthread_mutex_unlock(&pool->lock);
+
+        worker_run_tasks(pool, info->index, task, user_data);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->workers_finished++;
+        if (pool->workers_finished == pool->thread_count - 1)
+            pthread_cond_broadcast(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int thread_pool_default_thread_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+// Thread pool management. The calling thread acts as worker 0, so a pool of
+// one thread spawns nothing and renders everything inline.
+ThreadPool *thread_pool_create(int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = thread_pool_default_thread_count();
+
+    ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (!pool)
+        return NULL;
+
+    pool->thread_count = thread_count;
+    pool->deque_count = thread_count;
+    pool->deques = (TaskDeque *)calloc((size_t)thread_count, sizeof(TaskDeque));
+    pool->workers = (WorkerInfo *)calloc((size_t)thread_count, sizeof(WorkerInfo));
+    pool->threads = (pthread_t *)calloc((size_t)thread_count, sizeof(pthread_t));
+    if (!pool->deques || !pool->workers || !pool->threads)
+    {
+        free(pool->deques);
+        free(pool->workers);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+    }
+
+    for (int i = 1; i < thread_count; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]) != 0)
+        {
+            fprintf(stderr, "Failed to start worker thread %d, using %d threads\n", i, i);
+            pool->thread_count = i;
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->thread_count; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool->deque_count; i++)
+    {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(ThreadPool *pool)
+{
+    return pool ? pool->thread_count : 1;
+}
+
+// Run task(user_data, i, thread) for every i in [0, task_count) and wait.
+// Each worker starts with a contiguous block of indices; idle workers steal.
+void thread_pool_run(ThreadPool *pool, int task_count, ThreadPoolTask task, void *user_data)
+{
+    if (task_count <= 0)
+        return;
+
+    if (!pool || pool->thread_count == 1)
+    {
+        for (int i = 0; i < task_count; i++)
+        {
+            task(user_data, i, 0);
+        }
+        return;
+    }
+
+    int threads = pool->thread_count;
+    for (int t = 0; t < threads; t++)
+    {
+        TaskDeque *deque = &pool->deques[t];
+        int begin = (int)((long long)task_count * t / threads);
+        int end = (int)((long long)task_count * (t + 1) / threads);
+
+        // Every worker is parked between runs, so the deques can be refilled
+        if (deque->capacity < end - begin)
+        {
+            int *tasks = (int *)realloc(deque->tasks, sizeof(int) * (size_t)(end - begin));
+            if (!tasks)
+            {
+                fprintf(stderr, "Thread pool out of memory, running tasks serially\n");
+                for (int i = 0; i < task_count; i++)
+                    task(user_data, i, 0);
+                return;
+            }
+            deque->tasks = tasks;
+            deque->capacity = end - begin;
+        }
+
+        pthread_mutex_lock(&deque->lock);
+        for (int i = begin; i < end; i++)
+        {
+            deque->tasks[i - begin] = i;
+        }
+        deque->head = 0;
+        deque->tail = end - begin;
+        pthread_mutex_unlock(&deque->lock);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->user_data = user_data;
+    pool->tasks_remaining = task_count;
+    pool->workers_finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    worker_run_tasks(pool, 0, task, user_data);
+
+    // Wait for the last task and for every worker to park again, so no worker
+    // can pick up the next run's tasks with this run's callback
+    pthread_mutex_lock(&pool->lock);
+    while (pool->tasks_remaining > 0 || pool->workers_finished < pool->thread_count - 1)
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L // pthread_once under -std=c99
+#include "raytracing.h"
+#include <pthread.h>
+
+// Post-process stage turning the HDR framebuffer into packed RGBA8 pixels:
+// exposure, tone curve, clamp, optional sRGB encoding and ordered dither,
+// then truncation to 8 bits. With the default settings every pixel gets
+// exactly the bytes framebuffer_pack_color would produce. Four pixels are
+// converted at a time with SSE2 where available.
+
+#if defined(__SSE2__)
+#define TONEMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// sRGB encoding is looked up by the square root of the linear value, which
+// keeps table steps well under one 8-bit code across the whole range
+#define SRGB_TABLE_SIZE 4096
+
+static float srgb_table[SRGB_TABLE_SIZE];
+static pthread_once_t srgb_once = PTHREAD_ONCE_INIT;
+
+static void srgb_table_init(void)
+{
+    for (int i = 0; i < SRGB_TABLE_SIZE; i++)
+    {
+        float root = (float)i / (float)(SRGB_TABLE_SIZE - 1);
+        float linear = root * root;
+        srgb_table[i] = linear <= 0.0031308f ? 12.92f * linear : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+    }
+}
+
+// 4x4 Bayer matrix as offsets in [0, 1) added before truncating to 8 bits
+static const float bayer_offsets[4][4] = {
+    {0.5f / 16, 8.5f / 16, 2.5f / 16, 10.5f / 16},
+    {12.5f / 16, 4.5f / 16, 14.5f / 16, 6.5f / 16},
+    {3.5f / 16, 11.5f / 16, 1.5f / 16, 9.5f / 16},
+    {15.5f / 16, 7.5f / 16, 13.5f / 16, 5.5f / 16}};
+
+static const float no_dither[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+static float tone_curve(float v, ToneCurve curve)
+{
+    switch (curve)
+    {
+    case TONE_CURVE_REINHARD:
+        return v / (1.0f + v);
+    case TONE_CURVE_ACES:
+        // Narkowicz's fit of the ACES filmic curve
+        return (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+    default:
+        return v;
+    }
+}
+
+static Uint32 tonemap_channel(float v, float scale, const ToneMapSettings *settings, float dither)
+{
+    v = fmaxf(0.0f, fminf(1.0f, tone_curve(v * scale, settings->curve)));
+    if (settings->srgb)
+        v = srgb_table[(int)(sqrtf(v) * (float)(SRGB_TABLE_SIZE - 1) + 0.5f)];
+    return (Uint32)(v * 255 + dither);
+}
+
+#ifdef TONEMAP_SSE2
+static __m128 tone_curve4(__m128 v, ToneCurve curve)
+{
+    __m128 one = _mm_set1_ps(1.0f);
+    switch (curve)
+    {
+    case TONE_CURVE_REINHARD:
+        return _mm_div_ps(v, _mm_add_ps(one, v));
+    case TONE_CURVE_ACES:
+    {
+        __m128 num = _mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), v), _mm_set1_ps(0.03f)));
+        __m128 den = _mm_add_ps(_mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), v), _mm_set1_ps(0.59f))),
+                                _mm_set1_ps(0.14f));
+        return _mm_div_ps(num, den);
+    }
+    default:
+        return v;
+    }
+}
+
+// One channel of four pixels, as integers 0..255
+static __m128i tonemap_channel4(__m128 v, __m128 scale, const ToneMapSettings *settings, __m128 dither)
+{
+    v = tone_curve4(_mm_mul_ps(v, scale), settings->curve);
+    v = _mm_max_ps(_mm_min_ps(v, _mm_set1_ps(1.0f)), _mm_setzero_ps()); // min first maps NaN to 1
+
+    if (settings->srgb)
+    {
+        int index[4];
+        __m128 position = _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(v), _mm_set1_ps((float)(SRGB_TABLE_SIZE - 1))),
+                                     _mm_set1_ps(0.5f));
+        _mm_storeu_si128((__m128i *)index, _mm_cvttps_epi32(position));
+        v = _mm_set_ps(srgb_table[index[3]], srgb_table[index[2]], srgb_table[index[1]], srgb_table[index[0]]);
+    }
+
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), dither));
+}
+#endif
+
+// Convert rows [first_row, first_row + row_count) of hdr_pixels into pixels.
+// NULL settings means plain clamping, the same as framebuffer_pack_color.
+void framebuffer_tonemap(Framebuffer *framebuffer, const ToneMapSettings *settings, int first_row, int row_count)
+{
+    static const ToneMapSettings defaults = {0.0f, TONE_CURVE_CLAMP, false, false};
+    if (!settings)
+        settings = &defaults;
+    if (!framebuffer->hdr_pixels)
+        return;
+    if (settings->srgb)
+        pthread_once(&srgb_once, srgb_table_init);
+
+    int width = framebuffer->width;
+    int last_row = first_row + row_count < framebuffer->height ? first_row + row_count : framebuffer->height;
+    float scale = exp2f(settings->exposure);
+
+    for (int y = first_row; y < last_row; y++)
+    {
+        const Color *src = framebuffer->hdr_pixels + (size_t)y * width;
+        Uint32 *dst = framebuffer->pixels + (size_t)y * width;
+        const float *dither = settings->dither ? bayer_offsets[y & 3] : no_dither;
+        int x = 0;
+
+#ifdef TONEMAP_SSE2
+        __m128 scale4 = _mm_set1_ps(scale);
+        __m128 dither4 = _mm_loadu_ps(dither); // x advances by 4, so the row's pattern repeats
+        __m128i alpha = _mm_set1_epi32(0xFF);
+        for (; x + 4 <= width; x += 4)
+        {
+            const Color *c = src + x;
+            __m128i r = tonemap_channel4(_mm_set_ps(c[3].r, c[2].r, c[1].r, c[0].r), scale4, settings, dither4);
+            __m128i g = tonemap_channel4(_mm_set_ps(c[3].g, c[2].g, c[1].g, c[0].g), scale4, settings, dither4);
+            __m128i b = tonemap_channel4(_mm_set_ps(c[3].b, c[2].b, c[1].b, c[0].b), scale4, settings, dither4);
+
+            __m128i packed = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 24), _mm_slli_epi32(g, 16)),
+                                          _mm_or_si128(_mm_slli_epi32(b, 8), alpha));
+            _mm_storeu_si128((__m128i *)(dst + x), packed);
+        }
+#endif
+
+        for (; x < width; x++)
+        {
+            float d = dither[x & 3];
+            dst[x] = tonemap_channel(src[x].r, scale, settings, d) << 24 |
+                     tonemap_channel(src[x].g, scale, settings, d) << 16 |
+                     tonemap_channel(src[x].b, scale, settings, d) << 8 | 0xFFu;
+        }
+    }
+}
@@ -0,0 +1,182 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime under -std=c99
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Timeline capture in the Chrome trace event format, viewable in
+// chrome://tracing or ui.perfetto.dev. Each thread that records a span gets
+// its own ring of the most recent TRACE_RING_EVENTS spans; only the owner
+// writes to it, publishing each event by advancing the ring head, so
+// recording never takes a lock. Rings are kept until exit so a dump still
+// includes threads that have finished.
+
+#define TRACE_RING_EVENTS 16384 // per thread, a few frames of tile and stage spans
+#define TRACE_NAME_LENGTH 32
+
+typedef struct
+{
+    const char *name; // string literal
+    Uint64 start;     // nanoseconds, CLOCK_MONOTONIC
+    Uint64 duration;
+    int arg;
+} TraceEvent;
+
+typedef struct TraceBuffer
+{
+    struct TraceBuffer *next;
+    int thread_id;
+    char thread_name[TRACE_NAME_LENGTH];
+    Uint64 head; // events ever written; the ring holds the last TRACE_RING_EVENTS
+    TraceEvent events[TRACE_RING_EVENTS];
+} TraceBuffer;
+
+static bool capture_running;
+static Uint64 capture_start;
+static TraceBuffer *buffers; // every thread's ring, newest first
+static int next_thread_id;
+
+static __thread TraceBuffer *thread_buffer;
+static __thread bool thread_buffer_failed;
+static __thread char thread_name[TRACE_NAME_LENGTH];
+
+static Uint64 trace_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Uint64)now.tv_sec * 1000000000ull + (Uint64)now.tv_nsec;
+}
+
+// Label the calling thread in the timeline, e.g. ("worker", 3)
+void trace_set_thread_name(const char *name, int index)
+{
+    if (index >= 0)
+        snprintf(thread_name, sizeof(thread_name), "%s %d", name, index);
+    else
+        snprintf(thread_name, sizeof(thread_name), "%s", name);
+    if (thread_buffer)
+        memcpy(thread_buffer->thread_name, thread_name, sizeof(thread_name));
+}
+
+// The calling thread's ring, created on its first span
+static TraceBuffer *get_thread_buffer(void)
+{
+    if (thread_buffer || thread_buffer_failed)
+        return thread_buffer;
+
+    TraceBuffer *buffer = (TraceBuffer *)calloc(1, sizeof(TraceBuffer));
+    if (!buffer)
+    {
+        fprintf(stderr, "Failed to allocate a trace buffer; this thread's spans are dropped\n");
+        thread_buffer_failed = true;
+        return NULL;
+    }
+
+    buffer->thread_id = __atomic_add_fetch(&next_thread_id, 1, __ATOMIC_RELAXED);
+    if (thread_name[0])
+        memcpy(buffer->thread_name, thread_name, sizeof(thread_name));
+    else
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread %d", buffer->thread_id);
+
+    buffer->next = __atomic_load_n(&buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&buffers, &buffer->next, buffer, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    thread_buffer = buffer;
+    return buffer;
+}
+
+// Discard earlier spans and start recording
+void trace_start(void)
+{
+    __atomic_store_n(&capture_start, trace_now(), __ATOMIC_RELAXED);
+    __atomic_store_n(&capture_running, true, __ATOMIC_RELEASE);
+}
+
+void trace_stop(void)
+{
+    __atomic_store_n(&capture_running, false, __ATOMIC_RELEASE);
+}
+
+bool trace_active(void)
+{
+    return __atomic_load_n(&capture_running, __ATOMIC_RELAXED);
+}
+
+// Start time of a span, or 0 when no capture is running (the span is then
+// ignored by trace_span_end), so an idle trace costs one load per span
+Uint64 trace_span_begin(void)
+{
+    return trace_active() ? trace_now() : 0;
+}
+
+// Record a span from trace_span_begin until now. name must outlive the
+// capture (a string literal); arg >= 0 is shown as the span's index. Spans
+// still open when the capture stops are dropped, so once trace_stop returns
+// each thread writes at most the one event it may already be storing.
+void trace_span_end(const char *name, Uint64 start, int arg)
+{
+    if (start == 0 || !__atomic_load_n(&capture_running, __ATOMIC_ACQUIRE))
+        return;
+
+    TraceBuffer *buffer = get_thread_buffer();
+    if (!buffer)
+        return;
+
+    TraceEvent *event = &buffer->events[buffer->head % TRACE_RING_EVENTS];
+    event->name = name;
+    event->start = start;
+    event->duration = trace_now() - start;
+    event->arg = arg;
+    __atomic_store_n(&buffer->head, buffer->head + 1, __ATOMIC_RELEASE);
+}
+
+// Write the spans of the current (or last) capture as Chrome trace JSON.
+// Stop the capture first. Other threads may still be finishing a span
+// then; such an event is stored in the slot after the ring head, which on
+// a full ring is the oldest one, so that slot is never read.
+int trace_write(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+        return -1;
+    }
+
+    Uint64 base = __atomic_load_n(&capture_start, __ATOMIC_RELAXED);
+    bool first = true;
+    long event_count = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (TraceBuffer *buffer = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next)
+    {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", buffer->thread_id, buffer->thread_name);
+        first = false;
+
+        Uint64 head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+        Uint64 oldest = head >= TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS + 1 : 0;
+        for (Uint64 i = oldest; i < head; i++)
+        {
+            const TraceEvent *event = &buffer->events[i % TRACE_RING_EVENTS];
+            if (event->start < base)
+                continue; // from an earlier capture
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", event->name,
+                    buffer->thread_id, (double)(event->start - base) * 1e-3, (double)event->duration * 1e-3);
+            if (event->arg >= 0)
+                fprintf(file, ",\"args\":{\"index\":%d}", event->arg);
+            fputc('}', file);
+            event_count++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return -1;
+    }
+    printf("Wrote %ld trace events to %s\n", event_count, path);
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
 
 // Graphics initialization and cleanup
 int init_graphics(SDL_Window **window, SDL_Renderer **renderer)
@@ -38,6 +40,63 @@ void cleanup_graphics(SDL_Window *window, SDL_Renderer *renderer)
     SDL_Quit();
 }
 
+// Streaming texture matching the framebuffer layout
+SDL_Texture *framebuffer_create_texture(SDL_Renderer *renderer, Framebuffer *framebuffer)
+{
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                             SDL_TEXTUREACCESS_STREAMING,
+                                             framebuffer->width, framebuffer->height);
+    if (!texture)
+    {
+        fprintf(stderr, "SDL_CreateTexture Error: %s\n", SDL_GetError());
+    }
+    return texture;
+}
+
+// Upload the whole framebuffer in one lock and draw it with a single copy
+void framebuffer_blit(SDL_Renderer *renderer, SDL_Texture *texture, Framebuffer *framebuffer)
+{
+    void *texture_pixels;
+    int texture_pitch;
+    int row_bytes = framebuffer->width * (int)sizeof(Uint32);
+
+    if (SDL_LockTexture(texture, NULL, &texture_pixels, &texture_pitch) == 0)
+    {
+        if (texture_pitch == row_bytes)
+        {
+            memcpy(texture_pixels, framebuffer->pixels, (size_t)row_bytes * framebuffer->height);
+        }
+        else
+        {
+            for (int y = 0; y < framebuffer->height; y++)
+            {
+                memcpy((Uint8 *)texture_pixels + (size_t)y * texture_pitch,
+                       framebuffer->pixels + (size_t)y * framebuffer->width, (size_t)row_bytes);
+            }
+        }
+        SDL_UnlockTexture(texture);
+    }
+    else
+    {
+        SDL_UpdateTexture(texture, NULL, framebuffer->pixels, row_bytes);
+    }
+
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+}
+
+// Read an optional "--threads N" argument (0 = one thread per CPU)
+int parse_thread_count(int argc, char *argv[])
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0)
+        {
+            return atoi(argv[i + 1]);
+        }
+    }
+    return 0;
+}
+
 void handle_events(SDL_Event *event, bool *running, Vector3 *light_pos, RenderSettings *settings, Camera *camera)
 {
     while (SDL_PollEvent(event))
@@ -77,6 +136,40 @@ void handle_events(SDL_Event *event, bool *running, Vector3 *light_pos, RenderSe
                 settings->enable_anti_aliasing = !settings->enable_anti_aliasing;
                 printf("Anti-aliasing: %s\n", settings->enable_anti_aliasing ? "ON" : "OFF");
                 break;
+            case SDLK_4:
+                // Toggle progressive accumulation of anti-aliasing samples
+                settings->enable_progressive = !settings->enable_progressive;
+                printf("Progressive anti-aliasing: %s\n", settings->enable_progressive ? "ON" : "OFF");
+                break;
+            case SDLK_5:
+                // Toggle adaptive sample counts for anti-aliasing
+                settings->enable_adaptive_aa = !settings->enable_adaptive_aa;
+                printf("Adaptive anti-aliasing: %s\n", settings->enable_adaptive_aa ? "ON" : "OFF");
+                break;
+            case SDLK_6:
+                // Switch between the recursive and the wavefront tracer
+                settings->enable_wavefront = !settings->enable_wavefront;
+                printf("Wavefront tracing: %s\n", settings->enable_wavefront ? "ON" : "OFF");
+                break;
+            case SDLK_7:
+                // Draw the last frame's ray and intersection counters
+                settings->show_stats = !settings->show_stats;
+                printf("Stats overlay: %s\n", settings->show_stats ? "ON" : "OFF");
+                break;
+            case SDLK_8:
+                // Record a timeline of frames, tiles and stages until pressed again
+                if (!trace_active())
+                {
+                    trace_start();
+                    printf("Trace capture: ON\n");
+                }
+                else
+                {
+                    // Render threads may still be ending spans; trace_write skips their slots
+                    trace_stop();
+                    trace_write("raytracing_trace.json");
+                }
+                break;
             case SDLK_w:
                 // Move camera forward
                 camera->position = vector3_add(camera->position, vector3_create(0, 0, -0.5f));
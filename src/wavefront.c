@@ -0,0 +1,415 @@
+#include "raytracing.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Wavefront tracer. Instead of following one path at a time through
+// intersection, shading, shadows and reflections, a whole batch of camera
+// samples moves through each stage together: generate every primary ray,
+// intersect the queue in packets, shade the hits (queueing one shadow ray per
+// contributing light and one reflection ray per surviving path), trace the
+// shadow queue, then repeat with the reflection queue until it is empty.
+// Each stage is a tight loop over one kind of work, and the queues give
+// later passes a place to reorder it: with ray sorting enabled, bounce rays
+// are sorted by direction octant and origin before they are intersected.
+
+// A path waiting to be intersected
+typedef struct
+{
+    Ray ray;
+    float throughput;
+    int slot;   // pixel of the batch whose sum the path adds to
+    Uint32 seed;
+    int depth;
+} WavefrontRay;
+
+// A queued ray that hit a sphere
+typedef struct
+{
+    int ray; // index into the current ray queue
+    int sphere;
+    float distance;
+} WavefrontHit;
+
+// Light a hit receives unless something blocks the shadow ray
+typedef struct
+{
+    Ray ray;
+    float max_distance;
+    int light;
+    int slot;
+    Color contribution; // already scaled by the path throughput
+} WavefrontShadowRay;
+
+struct WavefrontQueues
+{
+    WavefrontRay *rays;
+    WavefrontRay *next_rays;
+    WavefrontHit *hits;
+    Uint64 *sort_keys; // sort key above ray index
+    Uint64 *sort_scratch;
+    int ray_capacity; // rays, next_rays, hits and the sort buffers
+    WavefrontShadowRay *shadow_rays;
+    int shadow_capacity;
+    Color *sums;
+    int sum_capacity;
+};
+
+WavefrontQueues *wavefront_create(void)
+{
+    WavefrontQueues *queues = (WavefrontQueues *)calloc(1, sizeof(WavefrontQueues));
+    if (!queues)
+        fprintf(stderr, "Failed to allocate wavefront queues\n");
+    return queues;
+}
+
+void wavefront_destroy(WavefrontQueues *queues)
+{
+    if (queues)
+    {
+        free(queues->rays);
+        free(queues->next_rays);
+        free(queues->hits);
+        free(queues->sort_keys);
+        free(queues->sort_scratch);
+        free(queues->shadow_rays);
+        free(queues->sums);
+        free(queues);
+    }
+}
+
+// Grow the queues to hold a batch; capacities only ever increase
+static bool wavefront_reserve(WavefrontQueues *queues, int ray_count, int shadow_count, int pixel_count)
+{
+    if (ray_count > queues->ray_capacity)
+    {
+        WavefrontRay *rays = (WavefrontRay *)realloc(queues->rays, sizeof(WavefrontRay) * (size_t)ray_count);
+        if (rays)
+            queues->rays = rays;
+        WavefrontRay *next_rays = (WavefrontRay *)realloc(queues->next_rays, sizeof(WavefrontRay) * (size_t)ray_count);
+        if (next_rays)
+            queues->next_rays = next_rays;
+        WavefrontHit *hits = (WavefrontHit *)realloc(queues->hits, sizeof(WavefrontHit) * (size_t)ray_count);
+        if (hits)
+            queues->hits = hits;
+        Uint64 *sort_keys = (Uint64 *)realloc(queues->sort_keys, sizeof(Uint64) * (size_t)ray_count);
+        if (sort_keys)
+            queues->sort_keys = sort_keys;
+        Uint64 *sort_scratch = (Uint64 *)realloc(queues->sort_scratch, sizeof(Uint64) * (size_t)ray_count);
+        if (sort_scratch)
+            queues->sort_scratch = sort_scratch;
+        if (!rays || !next_rays || !hits || !sort_keys || !sort_scratch)
+            return false;
+        queues->ray_capacity = ray_count;
+    }
+
+    if (shadow_count > queues->shadow_capacity)
+    {
+        WavefrontShadowRay *shadow_rays = (WavefrontShadowRay *)realloc(
+            queues->shadow_rays, sizeof(WavefrontShadowRay) * (size_t)shadow_count);
+        if (!shadow_rays)
+            return false;
+        queues->shadow_rays = shadow_rays;
+        queues->shadow_capacity = shadow_count;
+    }
+
+    if (pixel_count > queues->sum_capacity)
+    {
+        Color *sums = (Color *)realloc(queues->sums, sizeof(Color) * (size_t)pixel_count);
+        if (!sums)
+            return false;
+        queues->sums = sums;
+        queues->sum_capacity = pixel_count;
+    }
+    return true;
+}
+
+// Stage 1: camera rays for every sample of the batch, seeded like the
+// recursive path so both produce the same image
+static int generate_stage(WavefrontQueues *queues, const WavefrontBatch *batch)
+{
+    int batch_width = batch->x1 - batch->x0;
+    int count = 0;
+
+    for (int y = batch->y0; y < batch->y1; y++)
+    {
+        for (int x = batch->x0; x < batch->x1; x++)
+        {
+            Uint32 pixel_index = (Uint32)(y * batch->width + x);
+            int slot = (y - batch->y0) * batch_width + (x - batch->x0);
+
+            for (int sample = batch->first_sample; sample < batch->first_sample + batch->sample_count; sample++)
+            {
+                float u = (float)x / (float)batch->width;
+                float v = (float)(batch->height - y) / (float)batch->height;
+                if (batch->jitter)
+                {
+                    u = ((float)x + random_float(batch->seed, pixel_index, (Uint32)sample, 0)) / (float)batch->width;
+                    v = ((float)(batch->height - y) + random_float(batch->seed, pixel_index, (Uint32)sample, 1)) /
+                        (float)batch->height;
+                }
+
+                WavefrontRay *ray = &queues->rays[count++];
+                ray->ray = camera_get_ray(*batch->camera, u, v);
+                ray->throughput = 1.0f;
+                ray->slot = slot;
+                ray->seed = random_path_seed(batch->seed, pixel_index, sample);
+                ray->depth = 0;
+            }
+        }
+    }
+    RENDER_STATS_ADD(rays[RAY_CAMERA], count);
+    return count;
+}
+
+// Stage 2: closest hits for the ray queue in packets; misses add the
+// background and leave the queue, hits are compacted into the hit queue
+static int intersect_stage(WavefrontQueues *queues, Scene *scene, int ray_count)
+{
+    int hit_count = 0;
+
+    for (int first = 0; first < ray_count; first += RAY_PACKET_SIZE)
+    {
+        RayPacket packet;
+        float distance[RAY_PACKET_SIZE];
+        int index[RAY_PACKET_SIZE];
+
+        ray_packet_clear(&packet);
+        packet.count = ray_count - first < RAY_PACKET_SIZE ? ray_count - first : RAY_PACKET_SIZE;
+        for (int lane = 0; lane < packet.count; lane++)
+            ray_packet_set(&packet, lane, queues->rays[first + lane].ray);
+
+        scene_closest_hit_packet(scene, &packet, distance, index);
+
+        for (int lane = 0; lane < packet.count; lane++)
+        {
+            WavefrontRay *ray = &queues->rays[first + lane];
+            if (index[lane] < 0)
+            {
+                if (ray->depth > 0)
+                    RENDER_STATS_DEPTH(ray->depth); // a reflection ray that missed ends its path
+                queues->sums[ray->slot] = color_add(queues->sums[ray->slot],
+                                                    color_scale(scene->background, ray->throughput));
+                continue;
+            }
+
+            WavefrontHit *hit = &queues->hits[hit_count++];
+            hit->ray = first + lane;
+            hit->sphere = index[lane];
+            hit->distance = distance[lane];
+        }
+    }
+    return hit_count;
+}
+
+// Stage 3: ambient and unshadowed direct light for every hit. Light that
+// needs a shadow test goes to the shadow queue, surviving paths to the next
+// ray queue. Returns the next ray count; *shadow_count receives the shadow rays.
+static int shade_stage(WavefrontQueues *queues, Scene *scene, RenderSettings *settings,
+                       int hit_count, int *shadow_count)
+{
+    int next_count = 0;
+    int shadows = 0;
+
+    for (int i = 0; i < hit_count; i++)
+    {
+        WavefrontHit *record = &queues->hits[i];
+        WavefrontRay *ray = &queues->rays[record->ray];
+        Color *sum = &queues->sums[ray->slot];
+        HitInfo hit;
+
+        scene_resolve_hit(scene, ray->ray, record->sphere, record->distance, &hit);
+        Vector3 view_dir = vector3_normalize(vector3_scale(ray->ray.direction, -1.0f));
+
+        for (int light = 0; light < scene->light_count; light++)
+        {
+            Color contribution;
+            if (!light_contribution(&hit, &scene->lights[light], view_dir, &contribution))
+                continue;
+
+            contribution = color_scale(contribution, ray->throughput);
+            if (!settings->enable_shadows)
+            {
+                *sum = color_add(*sum, contribution);
+                continue;
+            }
+
+            WavefrontShadowRay *shadow = &queues->shadow_rays[shadows++];
+            shadow->ray = shadow_ray_create(hit.point, scene->lights[light].position, &shadow->max_distance);
+            shadow->light = light;
+            shadow->slot = ray->slot;
+            shadow->contribution = contribution;
+        }
+
+        Color ambient = color_scale(hit.material->color, hit.material->ambient);
+        *sum = color_add(*sum, color_scale(ambient, ray->throughput));
+
+        float throughput = ray->throughput;
+        PathStep step = path_next_bounce(hit.material, settings, ray->depth, ray->seed, &throughput);
+        if (step == PATH_BACKGROUND)
+            *sum = color_add(*sum, color_scale(scene->background, throughput));
+        if (step != PATH_REFLECT)
+        {
+            RENDER_STATS_DEPTH(ray->depth);
+            continue;
+        }
+
+        RENDER_STATS_ADD(rays[RAY_REFLECTION], 1);
+        WavefrontRay *next = &queues->next_rays[next_count++];
+        next->ray = reflect_ray_create(ray->ray, &hit);
+        next->throughput = throughput;
+        next->slot = ray->slot;
+        next->seed = ray->seed;
+        next->depth = ray->depth + 1;
+    }
+
+    *shadow_count = shadows;
+    return next_count;
+}
+
+// Stage 4: occlusion for the shadow queue; unblocked light is added
+static void shadow_stage(WavefrontQueues *queues, Scene *scene, ShadowCache *shadow_cache, int shadow_count)
+{
+    for (int i = 0; i < shadow_count; i++)
+    {
+        WavefrontShadowRay *shadow = &queues->shadow_rays[i];
+        int *last_occluder = shadow_cache ? &shadow_cache->last_occluder[shadow->light] : NULL;
+
+        if (!scene_occluded(scene, shadow->ray, shadow->max_distance, last_occluder))
+            queues->sums[shadow->slot] = color_add(queues->sums[shadow->slot], shadow->contribution);
+    }
+}
+
+// Spread the low 9 bits of v so they occupy every third bit
+static Uint32 morton_spread(Uint32 v)
+{
+    v &= 0x1FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Cell of an origin coordinate on a 512-step grid over [min, min + 511 / scale]
+static Uint32 morton_cell(float value, float min, float scale)
+{
+    float cell = (value - min) * scale;
+    return cell > 0.0f ? (cell < 511.0f ? (Uint32)cell : 511u) : 0u;
+}
+
+// Between bounces: sort the ray queue by direction octant, then by a Morton
+// code of the origin within the queue's bounds, so packets hold rays that
+// start close together and head the same way and visit the same BVH nodes.
+// An LSD radix sort on 30-bit keys; bytes where every key agrees are skipped.
+static void sort_stage(WavefrontQueues *queues, int ray_count)
+{
+    if (ray_count < 2 * RAY_PACKET_SIZE)
+        return;
+
+    Vector3 min = queues->rays[0].ray.origin;
+    Vector3 max = min;
+    for (int i = 1; i < ray_count; i++)
+    {
+        Vector3 o = queues->rays[i].ray.origin;
+        min = vector3_create(o.x < min.x ? o.x : min.x, o.y < min.y ? o.y : min.y, o.z < min.z ? o.z : min.z);
+        max = vector3_create(o.x > max.x ? o.x : max.x, o.y > max.y ? o.y : max.y, o.z > max.z ? o.z : max.z);
+    }
+    Vector3 scale = vector3_create(max.x > min.x ? 511.0f / (max.x - min.x) : 0.0f,
+                                   max.y > min.y ? 511.0f / (max.y - min.y) : 0.0f,
+                                   max.z > min.z ? 511.0f / (max.z - min.z) : 0.0f);
+
+    Uint64 *keys = queues->sort_keys;
+    Uint64 *scratch = queues->sort_scratch;
+    for (int i = 0; i < ray_count; i++)
+    {
+        const Ray *ray = &queues->rays[i].ray;
+        Uint32 octant = (Uint32)(ray->direction.x < 0.0f) | (Uint32)(ray->direction.y < 0.0f) << 1 |
+                        (Uint32)(ray->direction.z < 0.0f) << 2;
+        Uint32 morton = morton_spread(morton_cell(ray->origin.x, min.x, scale.x)) |
+                        morton_spread(morton_cell(ray->origin.y, min.y, scale.y)) << 1 |
+                        morton_spread(morton_cell(ray->origin.z, min.z, scale.z)) << 2;
+        keys[i] = (Uint64)(octant << 27 | morton) << 32 | (Uint64)i;
+    }
+
+    for (int shift = 32; shift < 64; shift += 8)
+    {
+        int offsets[256] = {0};
+        for (int i = 0; i < ray_count; i++)
+            offsets[(keys[i] >> shift) & 0xFF]++;
+        if (offsets[(keys[0] >> shift) & 0xFF] == ray_count)
+            continue;
+
+        for (int bucket = 0, total = 0; bucket < 256; bucket++)
+        {
+            int bucket_count = offsets[bucket];
+            offsets[bucket] = total;
+            total += bucket_count;
+        }
+        for (int i = 0; i < ray_count; i++)
+            scratch[offsets[(keys[i] >> shift) & 0xFF]++] = keys[i];
+
+        Uint64 *swap = keys;
+        keys = scratch;
+        scratch = swap;
+    }
+
+    // Gather into the spare queue, which then becomes the current one
+    for (int i = 0; i < ray_count; i++)
+        queues->next_rays[i] = queues->rays[(Uint32)keys[i]];
+    WavefrontRay *swap = queues->rays;
+    queues->rays = queues->next_rays;
+    queues->next_rays = swap;
+}
+
+// Trace a batch through all stages. Returns the sum of its samples for each
+// pixel, row by row over the batch rectangle (valid until the next call), or
+// NULL when the queues cannot grow.
+Color *wavefront_trace(WavefrontQueues *queues, const WavefrontBatch *batch, Scene *scene,
+                       RenderSettings *settings, ShadowCache *shadow_cache)
+{
+    int pixel_count = (batch->x1 - batch->x0) * (batch->y1 - batch->y0);
+    int ray_count = pixel_count * batch->sample_count;
+
+    // Each hit queues at most one shadow ray per light and one reflection ray
+    if (!wavefront_reserve(queues, ray_count, ray_count * (scene->light_count > 0 ? scene->light_count : 1), pixel_count))
+    {
+        fprintf(stderr, "Failed to grow wavefront queues to %d rays\n", ray_count);
+        return NULL;
+    }
+
+    memset(queues->sums, 0, sizeof(Color) * (size_t)pixel_count);
+    Uint64 span = trace_span_begin();
+    ray_count = generate_stage(queues, batch);
+    trace_span_end("generate", span, -1);
+
+    // Stage spans carry the bounce they belong to
+    for (int bounce = 0; ray_count > 0; bounce++)
+    {
+        int shadow_count;
+        span = trace_span_begin();
+        int hit_count = intersect_stage(queues, scene, ray_count);
+        trace_span_end("intersect", span, bounce);
+
+        span = trace_span_begin();
+        ray_count = shade_stage(queues, scene, settings, hit_count, &shadow_count);
+        trace_span_end("shade", span, bounce);
+
+        span = trace_span_begin();
+        shadow_stage(queues, scene, shadow_cache, shadow_count);
+        trace_span_end("shadow", span, bounce);
+
+        WavefrontRay *swap = queues->rays;
+        queues->rays = queues->next_rays;
+        queues->next_rays = swap;
+
+        // With a single leaf every packet tests every sphere, whatever the order
+        if (settings->enable_ray_sorting && !scene->bvh_dirty && scene->bvh.node_count > 1)
+        {
+            span = trace_span_begin();
+            sort_stage(queues, ray_count);
+            trace_span_end("sort", span, bounce);
+        }
+    }
+
+    return queues->sums;
+}